@@ -0,0 +1,407 @@
+/**
+ * @file hsilibs_throughput_benchmark.cxx Standalone throughput benchmark of the HSI data path
+ *
+ * A synthetic HSI source feeds frames packed as HSIEventSender packs them
+ * through a local queue into the HSIFrameProcessor stages and the
+ * HSILatencyBuffer, while the HSIRequestHandler serves data requests from
+ * the buffer. The (rate, burst size) sweep writes one JSON line per point to
+ * stdout and a summary line with the highest sustainable rate per burst size.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "HSIFrameProcessor.hpp"
+#include "HSILatencyBuffer.hpp"
+#include "HSIRequestHandler.hpp"
+#include "HSISignalMapSampler.hpp"
+#include "HSIThreadTuning.hpp"
+#include "LogHistogram.hpp"
+#include "hsilibs/HSIEventSender.hpp"
+#include "hsilibs/Types.hpp"
+
+#include "datahandlinglibs/FrameErrorRegistry.hpp"
+#include "dfmessages/DataRequest.hpp"
+
+#include <boost/program_options.hpp>
+#include <folly/ProducerConsumerQueue.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bpo = boost::program_options;
+
+namespace dunedaq {
+namespace hsilibs {
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct BenchmarkOptions
+{
+  std::vector<double> rates_hz;
+  std::vector<uint32_t> burst_sizes; // NOLINT(build/unsigned)
+  double duration_s = 2.;
+  std::size_t queue_size = 100000;
+  std::size_t buffer_size = 1000000;
+  double request_rate_hz = 100.;
+  uint64_t request_window_ticks = 62500;   // NOLINT(build/unsigned)
+  uint64_t request_delay_ticks = 625000;   // NOLINT(build/unsigned)
+  double clock_frequency_hz = 62.5e6;
+  double mean_signals = 1.;
+  double max_p99_latency_us = 1000.;
+  std::size_t processing_threads = 0;
+  std::size_t processing_queue_size = 10000;
+  std::size_t request_cache_size = 0;
+};
+
+// a frame on its way to the data handler, with the time the source produced it
+struct QueuedFrame
+{
+  HSI_FRAME_STRUCT frame;
+  clock_type::time_point generated;
+};
+
+// the frame processor stages, without the appmodel configuration its conf() needs
+class BenchmarkFrameProcessor : public HSIFrameProcessor
+{
+public:
+  using HSIFrameProcessor::HSIFrameProcessor;
+
+  using HSIFrameProcessor::configure_tasks;
+  using HSIFrameProcessor::start_task_pool;
+  using HSIFrameProcessor::stop_task_pool;
+  using HSIFrameProcessor::task_pool_dropped;
+
+  void postprocess(constframeptr fp) { signal_statistics(fp); }
+  int timestamp_errors() const { return m_ts_error_ctr.load(); }
+  int sequence_gaps() const { return m_seq_gap_ctr.load(); }
+};
+
+class BenchmarkRequestHandler : public HSIRequestHandler
+{
+public:
+  using HSIRequestHandler::HSIRequestHandler;
+  using HSIRequestHandler::set_cache_size;
+
+  uint64_t handled_requests() const { return m_requests.load(); }          // NOLINT(build/unsigned)
+  uint64_t cache_hits() const { return m_cache_hits.load(); }              // NOLINT(build/unsigned)
+  uint64_t cache_partial_hits() const { return m_cache_partial_hits.load(); } // NOLINT(build/unsigned)
+  uint64_t cache_misses() const { return m_cache_misses.load(); }          // NOLINT(build/unsigned)
+
+  // true if the whole window was found
+  bool request(const dfmessages::DataRequest& dr, std::size_t& fragment_bytes)
+  {
+    auto result = data_request(dr);
+    fragment_bytes = result.fragment != nullptr ? result.fragment->get_size() : 0;
+    return result.result_code == ResultCode::kFound;
+  }
+};
+
+template<class T>
+std::vector<T>
+parse_list(const std::string& list)
+{
+  std::vector<T> values;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      values.push_back(static_cast<T>(std::stod(item)));
+    }
+  }
+  return values;
+}
+
+// a field of /proc/self/status in kB, -1 if unavailable
+long
+read_status_kb(const std::string& field)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size() + 1, field + ":") == 0) {
+      return std::stol(line.substr(field.size() + 1));
+    }
+  }
+  return -1;
+}
+
+// sleep most of the way, spin the rest: the burst period can be well below the sleep resolution
+void
+wait_until(clock_type::time_point deadline)
+{
+  if (deadline - clock_type::now() > std::chrono::microseconds(200)) {
+    std::this_thread::sleep_until(deadline - std::chrono::microseconds(100));
+  }
+  while (clock_type::now() < deadline) {
+    cpu_relax();
+  }
+}
+
+template<std::size_t N>
+nlohmann::json
+histogram_json(const LogHistogram<N>& histogram)
+{
+  // quantiles are interpolated inside a bin and can overshoot the largest value seen
+  auto quantile = [&histogram](double q) { return std::min(histogram.quantile(q), static_cast<double>(histogram.max())); };
+  return { { "count", histogram.count() }, { "mean", histogram.mean() }, { "p50", quantile(0.5) },
+           { "p90", quantile(0.9) },       { "p99", quantile(0.99) },     { "p999", quantile(0.999) },
+           { "max", histogram.max() } };
+}
+
+nlohmann::json
+run_point(const BenchmarkOptions& options, double rate_hz, uint32_t burst_size) // NOLINT(build/unsigned)
+{
+  folly::ProducerConsumerQueue<QueuedFrame> queue(options.queue_size);
+  auto error_registry = std::make_unique<datahandlinglibs::FrameErrorRegistry>();
+  auto latency_buffer = std::make_unique<HSILatencyBuffer>(options.buffer_size);
+  // without workers the signal statistics run inline on the consumer (postprocess below), with
+  // workers they go to the pool together with the error check, as in a configured data handler
+  BenchmarkFrameProcessor processor(error_registry, options.processing_threads > 0);
+  processor.configure_tasks(options.processing_threads, options.processing_queue_size);
+  processor.start_task_pool();
+  BenchmarkRequestHandler request_handler(latency_buffer, error_registry);
+  request_handler.set_cache_size(options.request_cache_size);
+
+  std::atomic<bool> source_done{ false };
+  std::atomic<bool> consumer_done{ false };
+  std::atomic<uint64_t> last_timestamp{ 0 }; // NOLINT(build/unsigned)
+
+  // each counter and histogram has a single writer thread
+  uint64_t generated = 0;           // NOLINT(build/unsigned)
+  uint64_t dropped = 0;             // NOLINT(build/unsigned)
+  std::size_t max_queue_occupancy = 0;
+  uint64_t processed = 0;           // NOLINT(build/unsigned)
+  uint64_t buffer_overflows = 0;    // NOLINT(build/unsigned)
+  uint64_t requests = 0;            // NOLINT(build/unsigned)
+  uint64_t complete_requests = 0;   // NOLINT(build/unsigned)
+  uint64_t fragment_bytes = 0;      // NOLINT(build/unsigned)
+  uint64_t cleanups = 0;            // NOLINT(build/unsigned)
+  LogHistogram<48> latency_ns;
+  LogHistogram<48> request_ns;
+  clock_type::time_point source_end;
+  uint64_t bursts = 0;              // NOLINT(build/unsigned)
+
+  auto ticks_per_ns = options.clock_frequency_hz * 1.e-9;
+  auto run_start = clock_type::now();
+
+  std::thread source([&]() {
+    HSISignalMapSampler sampler(HSISignalMapSampler::probability_from_poisson_mean(options.mean_signals));
+    std::mt19937_64 generator(burst_size);
+    auto burst_period = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(burst_size / rate_hz));
+    auto end = run_start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(options.duration_s));
+    uint64_t timestamp = 0; // NOLINT(build/unsigned)
+    uint32_t sequence = 0;  // NOLINT(build/unsigned)
+    for (auto next_burst = run_start; next_burst < end; next_burst += burst_period) {
+      wait_until(next_burst);
+      for (uint32_t i = 0; i < burst_size; ++i) { // NOLINT(build/unsigned)
+        auto now = clock_type::now();
+        uint64_t now_ticks = std::chrono::duration_cast<std::chrono::nanoseconds>(now - run_start).count() * ticks_per_ns; // NOLINT(build/unsigned)
+        timestamp = std::max(timestamp + 1, now_ticks + 1);
+        sequence = (sequence + 1) & 0xffff;
+        auto signal_map = sampler(generator);
+        auto raw_data = HSIEventSender::make_raw_hsi_data(timestamp, signal_map, signal_map, sequence);
+        ++generated;
+        if (!queue.write(QueuedFrame{ HSIEventSender::pack_raw_hsi_data(raw_data), now })) {
+          ++dropped;
+        }
+      }
+      max_queue_occupancy = std::max(max_queue_occupancy, queue.sizeGuess());
+      ++bursts;
+    }
+    source_end = clock_type::now();
+    source_done.store(true);
+  });
+
+  std::thread consumer([&]() {
+    QueuedFrame item;
+    while (true) {
+      if (!queue.read(item)) {
+        if (source_done.load() && queue.isEmpty()) {
+          break;
+        }
+        cpu_relax();
+        continue;
+      }
+      processor.preprocess_item(&item.frame);
+      if (latency_buffer->write(HSI_FRAME_STRUCT(item.frame))) {
+        last_timestamp.store(item.frame.get_timestamp(), std::memory_order_release);
+      } else {
+        ++buffer_overflows;
+      }
+      if (options.processing_threads == 0) {
+        processor.postprocess(&item.frame);
+      }
+      latency_ns.fill(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - item.generated).count());
+      ++processed;
+    }
+    consumer_done.store(true);
+  });
+
+  // requests and buffer cleanup, as the request handler thread of a data handler does them
+  std::thread requester([&]() {
+    auto request_period = std::chrono::duration_cast<clock_type::duration>(
+      std::chrono::duration<double>(1. / std::max(options.request_rate_hz, 1.e-3)));
+    auto next_request = clock_type::now() + request_period;
+    uint64_t trigger_number = 0; // NOLINT(build/unsigned)
+    while (!consumer_done.load()) {
+      if (latency_buffer->occupancy() > options.buffer_size * 8 / 10) {
+        latency_buffer->pop(options.buffer_size / 10);
+        ++cleanups;
+      }
+      auto newest = last_timestamp.load(std::memory_order_acquire);
+      if (clock_type::now() >= next_request &&
+          newest > options.request_delay_ticks + options.request_window_ticks) {
+        dfmessages::DataRequest dr;
+        dr.trigger_number = ++trigger_number;
+        dr.run_number = 1;
+        dr.request_information.window_end = newest - options.request_delay_ticks;
+        dr.request_information.window_begin = dr.request_information.window_end - options.request_window_ticks;
+        dr.trigger_timestamp = dr.request_information.window_begin;
+
+        std::size_t bytes = 0;
+        auto request_start = clock_type::now();
+        bool complete = request_handler.request(dr, bytes);
+        request_ns.fill(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - request_start).count());
+        ++requests;
+        complete_requests += complete;
+        fragment_bytes += bytes;
+        next_request += request_period;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+
+  source.join();
+  consumer.join();
+  requester.join();
+  // the workers finish their queues before the error counters are read
+  processor.stop_task_pool();
+  uint64_t pool_drops = processor.task_pool_dropped(); // NOLINT(build/unsigned)
+  uint64_t handled_requests = request_handler.handled_requests(); // NOLINT(build/unsigned)
+
+  // a source that fell behind its schedule takes longer than the bursts it sent
+  double elapsed_s = std::max(std::chrono::duration<double>(source_end - run_start).count(), bursts * burst_size / rate_hz);
+  double achieved_rate_hz = elapsed_s > 0 ? processed / elapsed_s : 0.;
+  bool sustainable = dropped == 0 && buffer_overflows == 0 && pool_drops == 0 && achieved_rate_hz >= 0.99 * rate_hz &&
+                     latency_ns.quantile(0.99) <= options.max_p99_latency_us * 1000.;
+
+  return { { "rate_hz", rate_hz },
+           { "burst_size", burst_size },
+           { "duration_s", elapsed_s },
+           { "generated", generated },
+           { "dropped", dropped },
+           { "processed", processed },
+           { "achieved_rate_hz", achieved_rate_hz },
+           { "max_queue_occupancy", max_queue_occupancy },
+           { "buffer_overflows", buffer_overflows },
+           { "buffer_cleanups", cleanups },
+           { "processing_threads", options.processing_threads },
+           { "task_pool_drops", pool_drops },
+           { "latency_ns", histogram_json(latency_ns) },
+           { "requests", requests },
+           { "complete_requests", complete_requests },
+           { "mean_fragment_bytes", requests > 0 ? static_cast<double>(fragment_bytes) / requests : 0. },
+           { "request_latency_ns", histogram_json(request_ns) },
+           { "request_cache_size", options.request_cache_size },
+           { "cache_hits", request_handler.cache_hits() },
+           { "cache_partial_hits", request_handler.cache_partial_hits() },
+           { "cache_misses", request_handler.cache_misses() },
+           { "cache_hit_rate",
+             handled_requests > 0 ? static_cast<double>(request_handler.cache_hits()) / handled_requests : 0. },
+           { "timestamp_errors", processor.timestamp_errors() },
+           { "sequence_gaps", processor.sequence_gaps() },
+           { "rss_kb", read_status_kb("VmRSS") },
+           { "peak_rss_kb", read_status_kb("VmHWM") },
+           { "sustainable", sustainable } };
+}
+
+} // namespace
+} // namespace hsilibs
+} // namespace dunedaq
+
+int
+main(int argc, char* argv[])
+{
+  using namespace dunedaq::hsilibs;
+
+  BenchmarkOptions options;
+  std::string rates = "1000,10000,100000,300000,1000000";
+  std::string burst_sizes = "1,10,100";
+
+  bpo::options_description desc(
+    "Sweeps rate and burst size through the HSI data path and writes one JSON line per point to stdout");
+  // clang-format off
+  desc.add_options()
+    ("help,h", "print this help")
+    ("rates", bpo::value<std::string>(&rates)->default_value(rates), "comma separated event rates [Hz]")
+    ("burst-sizes", bpo::value<std::string>(&burst_sizes)->default_value(burst_sizes), "comma separated numbers of back-to-back events per burst")
+    ("duration", bpo::value<double>(&options.duration_s)->default_value(options.duration_s), "time [s] per point")
+    ("queue-size", bpo::value<std::size_t>(&options.queue_size)->default_value(options.queue_size), "capacity of the source to data handler queue, in frames")
+    ("buffer-size", bpo::value<std::size_t>(&options.buffer_size)->default_value(options.buffer_size), "latency buffer capacity, in frames")
+    ("request-rate", bpo::value<double>(&options.request_rate_hz)->default_value(options.request_rate_hz), "data request rate [Hz]")
+    ("request-window", bpo::value<uint64_t>(&options.request_window_ticks)->default_value(options.request_window_ticks), "data request window [ticks]") // NOLINT(build/unsigned)
+    ("request-delay", bpo::value<uint64_t>(&options.request_delay_ticks)->default_value(options.request_delay_ticks), "age of the request window end [ticks]") // NOLINT(build/unsigned)
+    ("clock-frequency", bpo::value<double>(&options.clock_frequency_hz)->default_value(options.clock_frequency_hz), "timestamp clock frequency [Hz]")
+    ("mean-signals", bpo::value<double>(&options.mean_signals)->default_value(options.mean_signals), "mean number of signals per event")
+    ("max-p99-latency", bpo::value<double>(&options.max_p99_latency_us)->default_value(options.max_p99_latency_us), "highest p99 source to buffer latency [us] of a sustainable point")
+    ("processing-threads", bpo::value<std::size_t>(&options.processing_threads)->default_value(options.processing_threads), "frame processing pool workers, 0 runs the processing tasks inline")
+    ("processing-queue-size", bpo::value<std::size_t>(&options.processing_queue_size)->default_value(options.processing_queue_size), "capacity of each processing worker queue, in frames")
+    ("request-cache-size", bpo::value<std::size_t>(&options.request_cache_size)->default_value(options.request_cache_size), "request windows kept by the request handler cache, 0 disables it");
+  // clang-format on
+
+  try {
+    bpo::variables_map vm;
+    bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+    bpo::notify(vm);
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    options.rates_hz = parse_list<double>(rates);
+    options.burst_sizes = parse_list<uint32_t>(burst_sizes); // NOLINT(build/unsigned)
+  } catch (const std::exception& excpt) {
+    std::cerr << "Bad command line: " << excpt.what() << std::endl << desc << std::endl;
+    return 1;
+  }
+  options.rates_hz.erase(std::remove_if(options.rates_hz.begin(), options.rates_hz.end(), [](double r) { return r <= 0; }),
+                         options.rates_hz.end());
+  options.burst_sizes.erase(std::remove(options.burst_sizes.begin(), options.burst_sizes.end(), 0u),
+                            options.burst_sizes.end());
+  if (options.rates_hz.empty() || options.burst_sizes.empty() || options.queue_size < 2 || options.buffer_size < 10) {
+    std::cerr << "Need at least one positive rate and burst size, a queue of 2 and a buffer of 10 frames" << std::endl;
+    return 1;
+  }
+  std::sort(options.rates_hz.begin(), options.rates_hz.end());
+
+  nlohmann::json max_sustainable = nlohmann::json::object();
+  for (auto burst_size : options.burst_sizes) {
+    double best = 0.;
+    for (auto rate : options.rates_hz) {
+      std::cerr << "rate " << rate << " Hz, burst size " << burst_size << " ..." << std::endl;
+      auto point = run_point(options, rate, burst_size);
+      std::cout << point.dump() << std::endl;
+      if (point["sustainable"].get<bool>()) {
+        best = std::max(best, rate);
+      }
+    }
+    max_sustainable[std::to_string(burst_size)] = best;
+  }
+  std::cout << nlohmann::json{ { "max_sustainable_rate_hz", max_sustainable } }.dump() << std::endl;
+  return 0;
+}
@@ -16,6 +16,7 @@
 #include "iomanager/IOManager.hpp"
 #include <ers/Issue.hpp>
 
+#include <array>
 #include <bitset>
 #include <chrono>
 #include <memory>
@@ -46,6 +47,15 @@ public:
 
   void init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg) override;
 
+  // the 7 words of a raw HSI frame for one event, as sent to the data handler;
+  // source_id (20 bits) goes into the crate/slot/link fields, see HSI_FRAME_STRUCT::get_source_id
+  static std::array<uint32_t, 7> make_raw_hsi_data(uint64_t timestamp,     // NOLINT(build/unsigned)
+                                                   uint32_t data,          // NOLINT(build/unsigned)
+                                                   uint32_t trigger,       // NOLINT(build/unsigned)
+                                                   uint32_t sequence,      // NOLINT(build/unsigned)
+                                                   uint32_t source_id = 0); // NOLINT(build/unsigned)
+  static HSI_FRAME_STRUCT pack_raw_hsi_data(const std::array<uint32_t, 7>& raw_data);
+
 protected:
   // Commands
   virtual void do_configure(const nlohmann::json& obj) = 0;
@@ -67,6 +77,9 @@ protected:
   virtual void send_hsi_event(dfmessages::HSIEvent& event);
   virtual void send_raw_hsi_data(const std::array<uint32_t, 7>& raw_data, raw_sender_ct* sender);
 
+  // write the trace rings of this module's threads to directory and report the files
+  void dump_trace_rings(const std::string& directory, const std::string& reason);
+
   std::atomic<uint64_t> m_sent_counter;           // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_failed_to_send_counter; // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_last_sent_timestamp;    // NOLINT(build/unsigned)
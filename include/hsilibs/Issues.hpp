@@ -105,7 +105,59 @@ ERS_DECLARE_ISSUE_BASE(hsilibs,
 ERS_DECLARE_ISSUE(hsilibs,
                   InvalidTriggerRateValue,
                   " Trigger rate value " << trigger_rate << " invalid!",
-                  ((uint64_t)trigger_rate)) // NOLINT(build/unsigned)
+                  ((double)trigger_rate))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIFrameSequenceIssue,
+                  " HSI frame stream discontinuity from source " << source_id << ": sequence " << prev_seq << " -> "
+                                                                  << seq << ", timestamp " << prev_ts << " -> " << ts,
+                  ((uint32_t)source_id)((uint32_t)prev_seq)((uint32_t)seq)((uint64_t)prev_ts)((uint64_t)ts)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIProcessingBackpressure,
+                  " HSI processing worker queues (" << queue_size
+                                                    << " frames) are full, frame ingestion waits for the processing tasks",
+                  ((size_t)queue_size))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIProcessingFramesLost,
+                  " " << frames << " HSI frame(s) were not seen by the processing tasks, " << consequence,
+                  ((uint64_t)frames)((std::string)consequence)) // NOLINT(build/unsigned)
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSICaptureIssue,
+                  " HSI capture file " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSITraceIssue,
+                  " HSI trace file " << path << ": " << reason,
+                  ((std::string)path)((std::string)reason))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIConfigurationMismatch,
+                  " HSI device " << device << " readback does not match the requested configuration: " << details,
+                  ((std::string)device)((std::string)details))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  InvalidHSIMaskUpdate,
+                  " HSI device " << device << " rejected mask update: " << reason,
+                  ((std::string)device)((std::string)reason))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIDeviceNotReadyAtStart,
+                  " HSI device " << device << " not ready after waiting " << timeout_ms << " ms, starting anyway",
+                  ((std::string)device)((int64_t)timeout_ms))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIEndpointCommandFailed,
+                  " HSI endpoint(s) " << device << " failed " << command << ": " << reason,
+                  ((std::string)device)((std::string)command)((std::string)reason))
+
+ERS_DECLARE_ISSUE(hsilibs,
+                  HSIThreadTuningIssue,
+                  " Thread " << thread << " could not be tuned as configured: " << reason,
+                  ((std::string)thread)((std::string)reason))
 
 ERS_DECLARE_ISSUE_BASE(hsilibs,
                        QueueIsNullFatalError,
@@ -55,10 +55,24 @@ public:
     frame.set_timestamp(ts);
   }
 
+  // Frames of several (emulated) HSI devices can share one stream: the device
+  // id is carried in the crate (low 10 bits), slot (4) and link (6) fields and
+  // sequence counters and timestamps only increase per source
+  static const constexpr uint32_t s_source_id_mask = 0xfffff; // NOLINT(build/unsigned)
+
+  uint32_t get_source_id() const // NOLINT(build/unsigned)
+  {
+    return frame.crate | (frame.slot << 10) | (frame.link << 14);
+  }
+
   FrameType* begin() { return this; }
 
   FrameType* end() { return (this + 1); } // NOLINT
 
+  const FrameType* begin() const { return this; }
+
+  const FrameType* end() const { return (this + 1); } // NOLINT
+
   size_t get_payload_size() { return HSI_FRAME_STRUCT_SIZE; }
 
   size_t get_num_frames() { return 1; }
@@ -8,6 +8,10 @@
  */
 
 #include "FakeHSIEventGeneratorModule.hpp"
+#include "hsilibs/dal/HSIEmulatedDevice.hpp"
+#include "hsilibs/dal/HSIFakeGeneratorConf.hpp"
+#include "hsilibs/dal/HSILoadProfileSegment.hpp"
+#include "hsilibs/opmon/fake_generator_info.pb.h"
 
 #include "utilities/Issues.hpp"
 
@@ -21,9 +25,15 @@
 #include "confmodel/DetectorConfig.hpp"
 #include "rcif/cmd/Nljs.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
 #include <string>
+#include <utility>
 #include <thread>
 #include <vector>
 
@@ -34,8 +44,12 @@ FakeHSIEventGeneratorModule::FakeHSIEventGeneratorModule(const std::string& name
   : HSIEventSender(name)
   , m_thread(std::bind(&FakeHSIEventGeneratorModule::do_hsi_work, this, std::placeholders::_1))
   , m_timestamp_estimator(nullptr)
+  , m_free_running_clock(false)
+  , m_free_running_start_timestamp(0)
+  , m_interpolate_timestamps(false)
   , m_random_generator()
   , m_uniform_distribution(0, UINT32_MAX)
+  , m_fast_signal_map(false)
   , m_clock_frequency(62500000)
   , m_trigger_rate(1)        // Hz
   , m_active_trigger_rate(1) // Hz
@@ -47,11 +61,25 @@ FakeHSIEventGeneratorModule::FakeHSIEventGeneratorModule(const std::string& name
   , m_enabled_signals(0)
   , m_generated_counter(0)
   , m_last_generated_timestamp(0)
+  , m_burst_mode(false)
+  , m_max_burst_size(10000)
+  , m_wakeup_period(1000)
+  , m_scheduled_counter(0)
+  , m_trace_speed(1.)
+  , m_trace_loop(false)
+  , m_rate_overridden(false)
+  , m_profile_segment(SIZE_MAX)
+  , m_profile_cycle(0)
+  , m_segment_start_count(0)
+  , m_last_opmon_scheduled(0)
+  , m_last_opmon_time(std::chrono::steady_clock::now())
 {
   register_command("conf", &FakeHSIEventGeneratorModule::do_configure);
   register_command("start", &FakeHSIEventGeneratorModule::do_start);
   register_command("stop_trigger_sources", &FakeHSIEventGeneratorModule::do_stop);
   register_command("scrap", &FakeHSIEventGeneratorModule::do_scrap);
+  register_command("change_rate", &FakeHSIEventGeneratorModule::do_change_rate);
+  register_command("dump_trace", &FakeHSIEventGeneratorModule::do_dump_trace);
 }
 
 void
@@ -78,26 +106,47 @@ FakeHSIEventGeneratorModule::init(std::shared_ptr<appfwk::ModuleConfiguration> m
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
 }
 
-// void
-// FakeHSIEventGeneratorModule::get_info(opmonlib::InfoCollector& ci, int /*level*/)
-// {
-//   // send counters internal to the module
-//   fakehsieventgeneratorinfo::Info module_info;
-
-//   module_info.generated_hsi_events_counter = m_generated_counter.load();
-//   module_info.sent_hsi_events_counter = m_sent_counter.load();
-//   module_info.failed_to_send_hsi_events_counter = m_failed_to_send_counter.load();
-//   module_info.last_generated_timestamp = m_last_generated_timestamp.load();
-//   module_info.last_sent_timestamp = m_last_sent_timestamp.load();
+void
+FakeHSIEventGeneratorModule::generate_opmon_data()
+{
+  opmon::FakeHSIEventGeneratorInfo module_info;
+
+  module_info.set_generated_hsi_events_counter(m_generated_counter.load());
+  module_info.set_sent_hsi_events_counter(m_sent_counter.load());
+  module_info.set_failed_to_send_hsi_events_counter(m_failed_to_send_counter.load());
+  module_info.set_last_generated_timestamp(m_last_generated_timestamp.load());
+  module_info.set_last_sent_timestamp(m_last_sent_timestamp.load());
+
+  auto now = std::chrono::steady_clock::now();
+  auto scheduled = m_scheduled_counter.load();
+  double seconds = std::chrono::duration<double>(now - m_last_opmon_time).count();
+  if (seconds > 0 && scheduled >= m_last_opmon_scheduled) {
+    module_info.set_achieved_rate_hz((scheduled - m_last_opmon_scheduled) / seconds);
+  }
+  module_info.set_target_rate_hz(m_active_trigger_rate.load());
+  module_info.set_schedule_debt_us(m_rate_controller.schedule_debt_us());
+  module_info.set_max_lateness_us(m_rate_controller.lateness_us().max());
+  module_info.set_p99_lateness_us(m_rate_controller.lateness_us().quantile(0.99));
+  module_info.set_dropped_events(m_rate_controller.dropped());
+  if (m_interpolate_timestamps) {
+    module_info.set_interpolation_error_ticks(m_timestamp_interpolator.last_error());
+    module_info.set_max_interpolation_error_ticks(m_timestamp_interpolator.max_abs_error());
+    module_info.set_timestamp_anchors(m_timestamp_interpolator.anchors());
+  }
+  m_last_opmon_scheduled = scheduled;
+  m_last_opmon_time = now;
 
-//   ci.add(module_info);
-// }
+  publish(std::move(module_info));
+}
 
 void
 FakeHSIEventGeneratorModule::do_configure(const nlohmann::json& /*obj*/)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_configure() method";
 
+  // a trace of a previous configuration must not survive a reconfiguration without one
+  m_trace_reader.close();
+
   if (m_params->get_trigger_rate() > 0) {
     m_trigger_rate.store(m_params->get_trigger_rate());
     m_active_trigger_rate.store(m_trigger_rate.load());
@@ -117,8 +166,104 @@ FakeHSIEventGeneratorModule::do_configure(const nlohmann::json& /*obj*/)
   m_mean_signal_multiplicity = m_params->get_mean_signal_multiplicity();
   m_enabled_signals = m_params->get_enabled_signals();
 
+  auto ext_params = m_params->cast<dal::HSIFakeGeneratorConf>();
+  if (ext_params != nullptr) {
+    m_burst_mode = ext_params->get_burst_mode();
+    m_max_burst_size = std::max<uint32_t>(ext_params->get_max_burst_size(), 1); // NOLINT(build/unsigned)
+    m_wakeup_period = std::chrono::microseconds(std::max<uint32_t>(ext_params->get_wakeup_period_us(), 1)); // NOLINT(build/unsigned)
+    m_fast_signal_map = ext_params->get_fast_signal_map();
+    m_trace_speed = std::max(ext_params->get_trace_speed(), 0.);
+    m_trace_loop = ext_params->get_trace_loop();
+    m_free_running_clock = ext_params->get_timestamp_source() == "free_running";
+    m_free_running_start_timestamp = ext_params->get_free_running_start_timestamp();
+    m_arrival_process.configure(HSIArrivalProcess::model_from_string(ext_params->get_arrival_model()),
+                                ext_params->get_hawkes_branching_ratio(),
+                                ext_params->get_hawkes_decay_time_s(),
+                                ext_params->get_arrival_batch_size());
+    m_rate_controller.configure(HSIRateController::policy_from_string(ext_params->get_rate_control_policy()),
+                                ext_params->get_max_lateness_us() * 1.e-6);
+    m_interpolate_timestamps = ext_params->get_interpolate_timestamps();
+    m_timestamp_interpolator.configure(m_clock_frequency,
+                                       std::chrono::microseconds(ext_params->get_timestamp_reanchor_period_us()));
+    m_thread_settings = HSIThreadSettings::from_conf(ext_params->get_thread_conf());
+    m_devices.clear();
+    for (auto dev_conf : ext_params->get_emulated_devices()) {
+      EmulatedDevice device;
+      device.device_id = dev_conf->get_hsi_device_id();
+      device.trigger_rate = dev_conf->get_trigger_rate();
+      device.signal_emulation_mode = dev_conf->get_signal_emulation_mode();
+      device.enabled_signals = dev_conf->get_enabled_signals();
+      device.signal_map_sampler.set_probability(
+        HSISignalMapSampler::probability_from_poisson_mean(dev_conf->get_mean_signal_multiplicity()));
+      device.arrival_process.configure(HSIArrivalProcess::model_from_string(ext_params->get_arrival_model()),
+                                       ext_params->get_hawkes_branching_ratio(),
+                                       ext_params->get_hawkes_decay_time_s(),
+                                       ext_params->get_arrival_batch_size());
+      // independent random streams per device
+      device.arrival_process.seed(m_devices.size() + 1);
+      m_devices.push_back(std::move(device));
+    }
+  } else {
+    m_arrival_process.configure(HSIArrivalProcess::Model::kPeriodic, 0., 0., 1);
+    m_rate_controller.configure(HSIRateController::Policy::kCatchUp, 0.);
+    m_interpolate_timestamps = false;
+    m_devices.clear();
+    m_burst_mode = false;
+    m_fast_signal_map = false;
+    m_free_running_clock = false;
+    m_thread_settings = HSIThreadSettings();
+  }
+  if (!m_devices.empty()) {
+    TLOG() << get_name() << " Emulating " << m_devices.size() << " HSI devices";
+  }
+  if (!m_arrival_process.is_periodic()) {
+    TLOG() << get_name() << " Using " << HSIArrivalProcess::model_name(m_arrival_process.model())
+           << " event arrival times";
+  }
+  if (m_free_running_clock) {
+    TLOG() << get_name() << " Using a free-running clock at " << m_clock_frequency << " Hz, starting at timestamp "
+           << m_free_running_start_timestamp;
+  }
+
+  std::vector<HSILoadProfile::Segment> segments;
+  bool profile_loop = false;
+  if (ext_params != nullptr) {
+    for (auto seg_conf : ext_params->get_load_profile()) {
+      HSILoadProfile::Segment segment;
+      segment.shape = HSILoadProfile::shape_from_string(seg_conf->get_shape());
+      segment.duration_s = seg_conf->get_duration_s();
+      segment.rate_hz = seg_conf->get_rate_hz();
+      segment.secondary_rate_hz = seg_conf->get_secondary_rate_hz();
+      segment.amplitude_hz = seg_conf->get_amplitude_hz();
+      segment.period_s = seg_conf->get_period_s();
+      segment.duty_cycle = seg_conf->get_duty_cycle();
+      segments.push_back(segment);
+    }
+    profile_loop = ext_params->get_load_profile_loop();
+  }
+  m_load_profile.set_segments(std::move(segments), profile_loop);
+  if (!m_load_profile.empty()) {
+    TLOG() << get_name() << " Load profile of " << m_load_profile.size() << " segments over "
+           << m_load_profile.duration() << " s" << (profile_loop ? ", looped" : "");
+  }
+
+  if (ext_params != nullptr && !ext_params->get_trace_file().empty()) {
+    m_trace_reader.open(ext_params->get_trace_file());
+    TLOG() << get_name() << " Replaying " << m_trace_reader.size() << " entries from " << m_trace_reader.format()
+           << " file " << ext_params->get_trace_file() << ", speed: "
+           << (m_trace_speed > 0 ? std::to_string(m_trace_speed) : "as fast as possible")
+           << (m_trace_loop ? ", looped" : "");
+  }
+  if (m_burst_mode) {
+    TLOG() << get_name() << " Burst generation enabled, wakeup period [us]: " << m_wakeup_period.count()
+           << ", max events per wakeup: " << m_max_burst_size;
+  }
+
   // configure the random distributions
   m_poisson_distribution = std::poisson_distribution<uint64_t>(m_mean_signal_multiplicity); // NOLINT(build/unsigned)
+  // a bit fires in mode 1 when its Poisson draw is non-zero
+  m_signal_map_sampler.set_probability(
+    HSISignalMapSampler::probability_from_poisson_mean(m_mean_signal_multiplicity));
 
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_configure() method";
 }
@@ -129,13 +274,18 @@ FakeHSIEventGeneratorModule::do_start(const nlohmann::json& obj)
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
   auto start_params = obj.get<rcif::cmd::StartParams>();
 
-  m_timestamp_estimator.reset(new utilities::TimestampEstimator(start_params.run, m_clock_frequency));
-
-  m_timesync_receiver = get_iom_receiver<dfmessages::TimeSync>(".*");
-  m_timesync_receiver->add_callback(
-    std::bind(&utilities::TimestampEstimator::timesync_callback<dfmessages::TimeSync>,
-              reinterpret_cast<utilities::TimestampEstimator*>(m_timestamp_estimator.get()),
-              std::placeholders::_1));
+  if (m_free_running_clock) {
+    m_timestamp_estimator.reset(new HSIFreeRunningClock(m_clock_frequency, m_free_running_start_timestamp));
+  } else {
+    auto estimator = new utilities::TimestampEstimator(start_params.run, m_clock_frequency);
+    m_timestamp_estimator.reset(estimator);
+
+    m_timesync_receiver = get_iom_receiver<dfmessages::TimeSync>(".*");
+    m_timesync_receiver->add_callback(
+      std::bind(&utilities::TimestampEstimator::timesync_callback<dfmessages::TimeSync>,
+                estimator,
+                std::placeholders::_1));
+  }
 
   TLOG() << get_name() << " Using trigger rate, event period [us]: " << m_active_trigger_rate.load() << ", "
          << m_event_period.load();
@@ -178,9 +328,13 @@ FakeHSIEventGeneratorModule::do_stop(const nlohmann::json& /*args*/)
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
   m_thread.stop_working_thread();
 
-  m_timesync_receiver->remove_callback();
-  TLOG() << get_name() << ": received " << m_timestamp_estimator->get_received_timesync_count()
-         << " TimeSync messages.";
+  if (m_timesync_receiver) {
+    m_timesync_receiver->remove_callback();
+    m_timesync_receiver.reset();
+    TLOG() << get_name() << ": received "
+           << static_cast<utilities::TimestampEstimator*>(m_timestamp_estimator.get())->get_received_timesync_count()
+           << " TimeSync messages.";
+  }
 
   m_timestamp_estimator.reset(nullptr); // Calls TimestampEstimator dtor
 
@@ -197,9 +351,82 @@ void
 FakeHSIEventGeneratorModule::do_scrap(const nlohmann::json& /*args*/)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
+  m_trace_reader.close();
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
 }
 
+void
+FakeHSIEventGeneratorModule::do_change_rate(const nlohmann::json& args)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_change_rate() method";
+  // validate before using the value: a missing, non-numeric or non-finite rate is rejected as is
+  auto rate_arg = args.find("trigger_rate");
+  double rate = (rate_arg != args.end() && rate_arg->is_number()) ? rate_arg->get<double>()
+                                                                   : std::numeric_limits<double>::quiet_NaN();
+  if (!std::isfinite(rate) || rate < 0) {
+    ers::error(InvalidTriggerRateValue(ERS_HERE, rate));
+    return;
+  }
+  // an explicit rate takes over from the load profile until the end of the run
+  m_rate_overridden.store(true);
+  set_active_rate(rate);
+  TLOG() << get_name() << " Changing trigger rate, event period [us] to: " << m_active_trigger_rate.load() << ", "
+         << m_event_period.load();
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_change_rate() method";
+}
+
+void
+FakeHSIEventGeneratorModule::do_dump_trace(const nlohmann::json& args)
+{
+  dump_trace_rings(args.value("directory", m_thread_settings.trace_dump_directory),
+                   args.value("reason", std::string("dump_trace command")));
+}
+
+void
+FakeHSIEventGeneratorModule::set_active_rate(double rate)
+{
+  m_active_trigger_rate.store(rate);
+  if (rate > 0) {
+    m_event_period.store(1.e6 / rate);
+  }
+}
+
+void
+FakeHSIEventGeneratorModule::apply_load_profile(std::chrono::steady_clock::time_point now)
+{
+  if (m_load_profile.empty() || m_rate_overridden.load()) {
+    return;
+  }
+  double t = std::chrono::duration<double>(now - m_profile_start_time).count();
+  std::size_t segment = 0;
+  double rate = m_load_profile.rate_at(t, segment);
+  // a looping profile re-enters the same segments on every cycle
+  uint64_t cycle = segment < m_load_profile.size() ? static_cast<uint64_t>(t / m_load_profile.duration()) // NOLINT(build/unsigned)
+                                                   : m_profile_cycle;
+  if (segment != m_profile_segment || cycle != m_profile_cycle) {
+    log_profile_segment(now);
+    m_profile_segment = segment;
+    m_profile_cycle = cycle;
+    m_segment_start_count = m_scheduled_counter.load();
+    m_segment_start_time = now;
+  }
+  set_active_rate(rate);
+}
+
+void
+FakeHSIEventGeneratorModule::log_profile_segment(std::chrono::steady_clock::time_point now)
+{
+  if (m_profile_segment >= m_load_profile.size()) {
+    return;
+  }
+  auto& segment = m_load_profile.segment(m_profile_segment);
+  double seconds = std::chrono::duration<double>(now - m_segment_start_time).count();
+  double achieved = seconds > 0 ? (m_scheduled_counter.load() - m_segment_start_count) / seconds : 0.;
+  TLOG() << get_name() << ": load profile segment " << m_profile_segment << " ("
+         << HSILoadProfile::shape_name(segment.shape) << ", " << segment.rate_hz << " Hz) achieved " << achieved
+         << " Hz over " << seconds << " s";
+}
+
 uint32_t // NOLINT(build/unsigned)
 FakeHSIEventGeneratorModule::generate_signal_map()
 {
@@ -211,6 +438,10 @@ FakeHSIEventGeneratorModule::generate_signal_map()
       signal_map = UINT32_MAX;
       break;
     case 1:
+      if (m_fast_signal_map) {
+        signal_map = m_signal_map_sampler(m_random_generator);
+        break;
+      }
       for (uint i = 0; i < 32; ++i)
         if (m_poisson_distribution(m_random_generator))
           signal_map = signal_map | (1UL << i);
@@ -225,75 +456,88 @@ FakeHSIEventGeneratorModule::generate_signal_map()
   return signal_map;
 }
 
-void
-FakeHSIEventGeneratorModule::do_hsi_work(std::atomic<bool>& running_flag)
+dfmessages::timestamp_t
+FakeHSIEventGeneratorModule::current_timestamp()
 {
-  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering generate_hsievents() method";
-
-  // Wait for there to be a valid timestsamp estimate before we start
-  // TODO put in tome sort of timeout? Stoyan Trilov stoyan.trilov@cern.ch
-  if (m_timestamp_estimator.get() != nullptr && m_timestamp_estimator->wait_for_valid_timestamp(running_flag) ==
-                                                  utilities::TimestampEstimatorBase::kInterrupted) {
-    ers::error(utilities::FailedToGetTimestampEstimate(ERS_HERE));
-    return;
+  if (m_interpolate_timestamps) {
+    return m_timestamp_interpolator.get_timestamp();
   }
+  return m_timestamp_estimator->get_timestamp_estimate();
+}
 
-  m_generated_counter = 0;
-  m_sent_counter = 0;
-  m_last_generated_timestamp = 0;
-  m_last_sent_timestamp = 0;
-  m_failed_to_send_counter = 0;
+void
+FakeHSIEventGeneratorModule::emit_event(dfmessages::timestamp_t ts, uint32_t signal_map) // NOLINT(build/unsigned)
+{
+  ++m_scheduled_counter;
 
-  bool break_flag = false;
+  uint32_t trigger_map = signal_map & m_enabled_signals; // NOLINT(build/unsigned)
 
-  auto prev_gen_time = std::chrono::steady_clock::now();
+  TLOG_DEBUG(3) << "masked gen. map:" << std::bitset<32>(trigger_map);
+
+  // if at least one active signal, send a HSIEvent
+  if (!trigger_map) {
+    return;
+  }
 
-  while (!break_flag) {
+  ++m_generated_counter;
+  send_event(ts, signal_map, trigger_map, m_hsi_device_id, m_generated_counter);
+}
 
-    // emulate some signals
-    uint32_t signal_map = generate_signal_map();           // NOLINT(build/unsigned)
-    uint32_t trigger_map = signal_map & m_enabled_signals; // NOLINT(build/unsigned)
+void
+FakeHSIEventGeneratorModule::send_event(dfmessages::timestamp_t ts,
+                                        uint32_t signal_map,  // NOLINT(build/unsigned)
+                                        uint32_t trigger_map, // NOLINT(build/unsigned)
+                                        uint32_t device_id,   // NOLINT(build/unsigned)
+                                        uint64_t sequence)    // NOLINT(build/unsigned)
+{
+  ts += m_timestamp_offset;
 
-    TLOG_DEBUG(3) << "masked gen. map:" << std::bitset<32>(trigger_map);
+  m_last_generated_timestamp.store(ts);
+  hsi_trace(HSITraceStage::kGenerate, 0, ts, device_id, trigger_map, sequence);
 
-    // if at least one active signal, send a HSIEvent
-    if (trigger_map && m_timestamp_estimator.get() != nullptr) {
+  dfmessages::HSIEvent event = dfmessages::HSIEvent(device_id, trigger_map, ts, sequence, m_run_number);
+  send_hsi_event(event);
 
-      dfmessages::timestamp_t ts = m_timestamp_estimator->get_timestamp_estimate();
+  // Send raw HSI data to a DLH
+  auto hsi_struct = make_raw_hsi_data(ts, signal_map, trigger_map, sequence, device_id);
 
-      ts += m_timestamp_offset;
+  TLOG_DEBUG(3) << get_name() << ": Formed HSI_FRAME_STRUCT " << std::hex << "0x" << hsi_struct[0] << ", 0x"
+                << hsi_struct[1] << ", 0x" << hsi_struct[2] << ", 0x" << hsi_struct[3] << ", 0x" << hsi_struct[4]
+                << ", 0x" << hsi_struct[5] << ", 0x" << hsi_struct[6] << "\n";
 
-      ++m_generated_counter;
+  send_raw_hsi_data(hsi_struct, m_raw_hsi_data_sender.get());
+}
 
-      m_last_generated_timestamp.store(ts);
+void
+FakeHSIEventGeneratorModule::generate_paced(std::atomic<bool>& running_flag)
+{
+  bool break_flag = false;
 
-      dfmessages::HSIEvent event =
-        dfmessages::HSIEvent(m_hsi_device_id, trigger_map, ts, m_generated_counter, m_run_number);
-      send_hsi_event(event);
+  auto prev_gen_time = std::chrono::steady_clock::now();
+  // check running_flag and rate changes periodically
+  auto flag_check_period = std::chrono::milliseconds(1);
 
-      // Send raw HSI data to a DLH
-      std::array<uint32_t, 7> hsi_struct;
-      hsi_struct[0] = (0x1 << 6) | 0x1; // DAQHeader, frame version: 1, det id: 1
-      hsi_struct[1] = ts;
-      hsi_struct[2] = ts >> 32;
-      hsi_struct[3] = signal_map;
-      hsi_struct[4] = 0x0;
-      hsi_struct[5] = trigger_map;
-      hsi_struct[6] = m_generated_counter;
+  // short periods never enter the wait loop below, so the flag is also checked once per event
+  while (!break_flag && running_flag.load()) {
 
-      TLOG_DEBUG(3) << get_name() << ": Formed HSI_FRAME_STRUCT " << std::hex << "0x" << hsi_struct[0] << ", 0x"
-                    << hsi_struct[1] << ", 0x" << hsi_struct[2] << ", 0x" << hsi_struct[3] << ", 0x" << hsi_struct[4]
-                    << ", 0x" << hsi_struct[5] << ", 0x" << hsi_struct[6] << "\n";
+    auto now = std::chrono::steady_clock::now();
+    apply_load_profile(now);
 
-      send_raw_hsi_data(hsi_struct, m_raw_hsi_data_sender.get());
+    // prev_gen_time is the nominal time of this event
+    if (m_timestamp_estimator.get() != nullptr && m_active_trigger_rate.load() > 0 &&
+        !m_rate_controller.late(std::chrono::duration<double>(now - prev_gen_time).count())) {
+      emit_event(current_timestamp(), generate_signal_map());
     }
 
     // sleep for the configured event period, if trigger ticks are not 0, otherwise do not send anything
-    if (m_active_trigger_rate.load() > 0) {
+    double scheduled_rate = m_active_trigger_rate.load();
+    if (scheduled_rate > 0) {
       auto next_gen_time = prev_gen_time + std::chrono::microseconds(m_event_period.load());
+      if (!m_arrival_process.is_periodic()) {
+        next_gen_time = prev_gen_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                          std::chrono::duration<double>(m_arrival_process.next_interval(scheduled_rate)));
+      }
 
-      // check running_flag periodically
-      auto flag_check_period = std::chrono::milliseconds(1);
       auto next_flag_check_time = prev_gen_time + flag_check_period;
 
       while (next_gen_time > next_flag_check_time + flag_check_period) {
@@ -304,6 +548,20 @@ FakeHSIEventGeneratorModule::do_hsi_work(std::atomic<bool>& running_flag)
         }
         std::this_thread::sleep_until(next_flag_check_time);
         next_flag_check_time = next_flag_check_time + flag_check_period;
+
+        // a new rate (change_rate command or load profile step) applies to the interval being waited out:
+        // rescale it instead of sleeping out the old period
+        apply_load_profile(next_flag_check_time);
+        double rate = m_active_trigger_rate.load();
+        if (rate != scheduled_rate) {
+          if (rate <= 0) {
+            next_gen_time = next_flag_check_time;
+            break;
+          }
+          next_gen_time = prev_gen_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                            (next_gen_time - prev_gen_time) * (scheduled_rate / rate));
+          scheduled_rate = rate;
+        }
       }
       if (break_flag == false) {
         std::this_thread::sleep_until(next_gen_time);
@@ -312,9 +570,273 @@ FakeHSIEventGeneratorModule::do_hsi_work(std::atomic<bool>& running_flag)
       prev_gen_time = next_gen_time;
 
     } else {
-      std::this_thread::sleep_for(std::chrono::microseconds(250000));
+      std::this_thread::sleep_for(flag_check_period);
+      prev_gen_time = std::chrono::steady_clock::now();
+      continue;
+    }
+  }
+}
+
+void
+FakeHSIEventGeneratorModule::generate_bursts(std::atomic<bool>& running_flag)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  double next_event = 0.; // nominal time of the next event, seconds after start_time
+
+  while (running_flag.load()) {
+    auto now = std::chrono::steady_clock::now();
+    apply_load_profile(now);
+    double elapsed = std::chrono::duration<double>(now - start_time).count();
+
+    double rate = m_active_trigger_rate.load();
+    if (rate <= 0) {
+      // nothing is owed for the time spent paused
+      next_event = elapsed;
+      std::this_thread::sleep_until(now + m_wakeup_period);
       continue;
     }
+
+    if (next_event <= elapsed && m_timestamp_estimator.get() != nullptr) {
+      // one estimate per wakeup, earlier events are placed back along the schedule
+      dfmessages::timestamp_t now_ts = current_timestamp();
+      uint32_t batch = 0; // NOLINT(build/unsigned)
+      while (next_event <= elapsed && batch < m_max_burst_size) {
+        if (m_rate_controller.late(elapsed - next_event)) {
+          next_event += m_arrival_process.next_interval(rate);
+          continue;
+        }
+        auto lag_ticks = std::min<dfmessages::timestamp_t>((elapsed - next_event) * m_clock_frequency, now_ts);
+        emit_event(now_ts - lag_ticks, generate_signal_map());
+        next_event += m_arrival_process.next_interval(rate);
+        ++batch;
+      }
+
+      // still behind the schedule: go round again without sleeping
+      if (next_event <= elapsed) {
+        continue;
+      }
+    }
+
+    std::this_thread::sleep_until(now + m_wakeup_period);
+  }
+}
+
+double
+FakeHSIEventGeneratorModule::device_rate_scale() const
+{
+  auto configured = m_trigger_rate.load();
+  return configured > 0 ? m_active_trigger_rate.load() / configured : 0.;
+}
+
+void
+FakeHSIEventGeneratorModule::emit_device_event(EmulatedDevice& device, dfmessages::timestamp_t ts)
+{
+  ++m_scheduled_counter;
+
+  uint32_t signal_map = 0; // NOLINT(build/unsigned)
+  switch (device.signal_emulation_mode) {
+    case 0:
+      signal_map = UINT32_MAX;
+      break;
+    case 1:
+      signal_map = device.signal_map_sampler(m_random_generator);
+      break;
+    case 2:
+      signal_map = m_uniform_distribution(m_random_generator);
+      break;
+    default:
+      break;
+  }
+  uint32_t trigger_map = signal_map & device.enabled_signals; // NOLINT(build/unsigned)
+  if (!trigger_map) {
+    return;
+  }
+
+  ++m_generated_counter;
+  ++device.sequence;
+  send_event(ts, signal_map, trigger_map, device.device_id, device.sequence);
+}
+
+void
+FakeHSIEventGeneratorModule::generate_devices(std::atomic<bool>& running_flag)
+{
+  // times are ns since start_time
+  using due_event_t = std::pair<uint64_t, std::size_t>; // NOLINT(build/unsigned)
+  const uint64_t wakeup_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_wakeup_period).count(); // NOLINT(build/unsigned)
+  HSITimerWheel<std::size_t> wheel(s_timer_wheel_slots, wakeup_ns);
+  // events due at this wakeup, earliest first, so the merged streams stay in timestamp order
+  std::priority_queue<due_event_t, std::vector<due_event_t>, std::greater<due_event_t>> due_events;
+
+  double scale = device_rate_scale();
+  for (std::size_t i = 0; i < m_devices.size(); ++i) {
+    auto& device = m_devices[i];
+    device.sequence = 0;
+    device.arrival_process.reset();
+    double rate = device.trigger_rate * scale;
+    wheel.schedule(rate > 0 ? device.arrival_process.next_interval(rate) * 1.e9 : 0, i);
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  while (running_flag.load()) {
+    auto now = std::chrono::steady_clock::now();
+    apply_load_profile(now);
+    scale = device_rate_scale();
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_time).count(); // NOLINT(build/unsigned)
+
+    wheel.advance(elapsed, [&](uint64_t due, std::size_t i) { due_events.emplace(due, i); }); // NOLINT(build/unsigned)
+
+    if (!due_events.empty() && m_timestamp_estimator.get() != nullptr) {
+      // one estimate per wakeup, events are placed back along their schedule
+      dfmessages::timestamp_t now_ts = current_timestamp();
+      uint32_t batch = 0; // NOLINT(build/unsigned)
+      while (!due_events.empty() && batch < m_max_burst_size) {
+        auto [due, i] = due_events.top();
+        due_events.pop();
+        auto& device = m_devices[i];
+        double rate = device.trigger_rate * scale;
+        if (rate <= 0) {
+          // paused: look again at the next wakeup
+          wheel.schedule(elapsed + wakeup_ns, i);
+          continue;
+        }
+
+        if (!m_rate_controller.late((elapsed - due) * 1.e-9)) {
+          auto lag_ticks = std::min<dfmessages::timestamp_t>((elapsed - due) * 1.e-9 * m_clock_frequency, now_ts);
+          emit_device_event(device, now_ts - lag_ticks);
+          ++batch;
+        }
+
+        auto next = due + std::max<uint64_t>(device.arrival_process.next_interval(rate) * 1.e9, 1); // NOLINT(build/unsigned)
+        if (next <= elapsed) {
+          due_events.emplace(next, i);
+        } else {
+          wheel.schedule(next, i);
+        }
+      }
+
+      // over the per-wakeup limit: the rest goes back to the wheel and we go round again without sleeping
+      if (!due_events.empty()) {
+        while (!due_events.empty()) {
+          wheel.schedule(due_events.top().first, due_events.top().second);
+          due_events.pop();
+        }
+        continue;
+      }
+    }
+
+    std::this_thread::sleep_until(now + m_wakeup_period);
+  }
+
+  for (auto& device : m_devices) {
+    TLOG_DEBUG(1) << get_name() << ": emulated HSI device " << device.device_id << " sent " << device.sequence
+                  << " events";
+  }
+}
+
+void
+FakeHSIEventGeneratorModule::replay_trace(std::atomic<bool>& running_flag)
+{
+  if (m_timestamp_estimator.get() == nullptr) {
+    return;
+  }
+
+  // trace ticks to our clock ticks
+  double tick_scale = 1.;
+  if (m_trace_reader.clock_frequency_hz() > 0 && m_clock_frequency > 0) {
+    tick_scale = static_cast<double>(m_clock_frequency) / m_trace_reader.clock_frequency_hz();
+  }
+  // timestamps follow the replay pace; as fast as possible keeps the recorded spacing
+  double ts_scale = m_trace_speed > 0 ? tick_scale / m_trace_speed : tick_scale;
+
+  m_trace_reader.rewind();
+  auto start_time = std::chrono::steady_clock::now();
+  dfmessages::timestamp_t start_ts = current_timestamp();
+  double elapsed_ticks = 0.; // in replayed clock ticks
+  HSITraceReader::Entry entry;
+
+  while (running_flag.load()) {
+    if (!m_trace_reader.next(entry)) {
+      if (!m_trace_loop) {
+        TLOG() << get_name() << ": end of trace reached";
+        break;
+      }
+      m_trace_reader.rewind();
+      if (!m_trace_reader.next(entry)) {
+        break;
+      }
+    }
+    elapsed_ticks += entry.delta_ticks * ts_scale;
+
+    if (m_trace_speed > 0) {
+      auto due = start_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double>(elapsed_ticks / m_clock_frequency));
+      // check running_flag periodically
+      for (auto now = std::chrono::steady_clock::now(); now < due; now = std::chrono::steady_clock::now()) {
+        if (!running_flag.load()) {
+          return;
+        }
+        std::this_thread::sleep_until(std::min(due, now + std::chrono::milliseconds(1)));
+      }
+    }
+
+    emit_event(start_ts + static_cast<dfmessages::timestamp_t>(elapsed_ticks), entry.signal_map);
+  }
+}
+
+void
+FakeHSIEventGeneratorModule::do_hsi_work(std::atomic<bool>& running_flag)
+{
+  TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering generate_hsievents() method";
+
+  apply_thread_settings(get_name() + "/fake-tsd-gen", m_thread_settings);
+
+  // Wait for there to be a valid timestsamp estimate before we start; a free-running clock is valid immediately
+  // TODO put in tome sort of timeout? Stoyan Trilov stoyan.trilov@cern.ch
+  if (!m_free_running_clock && m_timestamp_estimator.get() != nullptr &&
+      m_timestamp_estimator->wait_for_valid_timestamp(running_flag) == utilities::TimestampEstimatorBase::kInterrupted) {
+    ers::error(utilities::FailedToGetTimestampEstimate(ERS_HERE));
+    return;
+  }
+
+  m_generated_counter = 0;
+  m_sent_counter = 0;
+  m_last_generated_timestamp = 0;
+  m_last_sent_timestamp = 0;
+  m_failed_to_send_counter = 0;
+  m_scheduled_counter = 0;
+
+  auto run_start_time = std::chrono::steady_clock::now();
+  m_rate_overridden.store(false);
+  m_profile_start_time = run_start_time;
+  m_profile_segment = SIZE_MAX;
+  m_profile_cycle = 0;
+  m_arrival_process.reset();
+  m_timestamp_interpolator.reset(m_timestamp_estimator.get());
+  m_rate_controller.reset();
+
+  if (m_trace_reader.is_open()) {
+    replay_trace(running_flag);
+  } else if (!m_devices.empty()) {
+    generate_devices(running_flag);
+  } else if (m_burst_mode) {
+    generate_bursts(running_flag);
+  } else {
+    generate_paced(running_flag);
+  }
+
+  log_profile_segment(std::chrono::steady_clock::now());
+
+  if (m_interpolate_timestamps) {
+    TLOG() << get_name() << ": timestamp interpolation used " << m_timestamp_interpolator.anchors()
+           << " anchors, max error " << m_timestamp_interpolator.max_abs_error() << " ticks";
+  }
+
+  double run_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start_time).count();
+  if (run_seconds > 0) {
+    TLOG() << get_name() << ": target rate " << m_active_trigger_rate.load() << " Hz, achieved rate "
+           << m_scheduled_counter.load() / run_seconds << " Hz over " << run_seconds << " s; lateness p99 "
+           << m_rate_controller.lateness_us().quantile(0.99) << " us, max " << m_rate_controller.lateness_us().max()
+           << " us, " << m_rate_controller.dropped() << " late events dropped";
   }
 
   std::ostringstream oss_summ;
@@ -8,6 +8,16 @@
 #define HSILIBS_PLUGINS_FAKEHSIEVENTGENERATOR_HPP_
 
 #include "hsilibs/HSIEventSender.hpp"
+#include "HSIArrivalProcess.hpp"
+#include "HSIFreeRunningClock.hpp"
+#include "HSILoadProfile.hpp"
+#include "HSIRateController.hpp"
+#include "HSISignalMapSampler.hpp"
+#include "HSIThreadTuning.hpp"
+#include "HSITimerWheel.hpp"
+#include "HSITimestampInterpolator.hpp"
+#include "HSITraceReader.hpp"
+#include "HSITraceRing.hpp"
 
 #include "utilities/TimestampEstimator.hpp"
 
@@ -49,7 +59,9 @@ public:
   FakeHSIEventGeneratorModule& operator=(FakeHSIEventGeneratorModule&&) = delete; ///< FakeHSIEventGeneratorModule is not move-assignable
 
   void init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg) override;
-  //void get_info(opmonlib::InfoCollector& ci, int level) override;
+
+protected:
+  void generate_opmon_data() override;
 
 private:
   // Commands
@@ -57,19 +69,60 @@ private:
   void do_start(const nlohmann::json& obj) override;
   void do_stop(const nlohmann::json& obj) override;
   void do_scrap(const nlohmann::json& obj) override;
+  void do_change_rate(const nlohmann::json& obj);
+  void do_dump_trace(const nlohmann::json& obj);
 
   std::shared_ptr<raw_sender_ct> m_raw_hsi_data_sender;
   
   void do_hsi_work(std::atomic<bool>&);
   dunedaq::utilities::WorkerThread m_thread;
 
+  // one event per event period, sleeping in between
+  void generate_paced(std::atomic<bool>& running_flag);
+  // all events due since the last wakeup, with interpolated timestamps
+  void generate_bursts(std::atomic<bool>& running_flag);
+  // replay the deltas and signal maps of a recorded trace
+  void replay_trace(std::atomic<bool>& running_flag);
+  // if any enabled signal fired, send the HSIEvent and raw frame
+  void emit_event(dfmessages::timestamp_t ts, uint32_t signal_map); // NOLINT(build/unsigned)
+  void send_event(dfmessages::timestamp_t ts,
+                  uint32_t signal_map,  // NOLINT(build/unsigned)
+                  uint32_t trigger_map, // NOLINT(build/unsigned)
+                  uint32_t device_id,   // NOLINT(build/unsigned)
+                  uint64_t sequence);   // NOLINT(build/unsigned)
+
+  // Several emulated HSI devices scheduled from one timer wheel
+  struct EmulatedDevice
+  {
+    uint32_t device_id = 0;       // NOLINT(build/unsigned)
+    double trigger_rate = 0.;
+    uint signal_emulation_mode = 0; // NOLINT(build/unsigned)
+    uint32_t enabled_signals = 0; // NOLINT(build/unsigned)
+    HSISignalMapSampler signal_map_sampler;
+    HSIArrivalProcess arrival_process;
+    uint64_t sequence = 0; // NOLINT(build/unsigned)
+  };
+  static constexpr std::size_t s_timer_wheel_slots = 1024;
+  std::vector<EmulatedDevice> m_devices;
+  void generate_devices(std::atomic<bool>& running_flag);
+  void emit_device_event(EmulatedDevice& device, dfmessages::timestamp_t ts);
+  // device rates follow runtime rate changes in proportion to trigger_rate
+  double device_rate_scale() const;
+
   std::shared_ptr<iomanager::ReceiverConcept<dfmessages::TimeSync>> m_timesync_receiver;
 
   // Configuration
   std::atomic<daqdataformats::run_number_t> m_run_number;
 
   // Helper class for estimating DAQ time
-  std::unique_ptr<utilities::TimestampEstimator> m_timestamp_estimator;
+  std::unique_ptr<utilities::TimestampEstimatorBase> m_timestamp_estimator;
+  // Derive timestamps from the local steady clock instead of TimeSync messages
+  bool m_free_running_clock;
+  uint64_t m_free_running_start_timestamp; // NOLINT(build/unsigned)
+  // Per-event timestamps extrapolated from periodic estimator anchors
+  bool m_interpolate_timestamps;
+  HSITimestampInterpolator m_timestamp_interpolator;
+  dfmessages::timestamp_t current_timestamp();
 
   // Random Generatior
   std::default_random_engine m_random_generator;
@@ -78,6 +131,10 @@ private:
 
   uint32_t generate_signal_map(); // NOLINT(build/unsigned)
 
+  // mode 1 without one Poisson draw per bit
+  bool m_fast_signal_map;
+  HSISignalMapSampler m_signal_map_sampler;
+
   const appmodel::FakeHSIEventGeneratorConf* m_params;
   uint64_t m_clock_frequency;                     // NOLINT(build/unsigned)
   std::atomic<float> m_trigger_rate;
@@ -92,6 +149,41 @@ private:
   uint32_t m_enabled_signals;                       // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_generated_counter;        // NOLINT(build/unsigned)
   std::atomic<uint64_t> m_last_generated_timestamp; // NOLINT(build/unsigned)
+
+  // Burst generation
+  bool m_burst_mode;
+  uint32_t m_max_burst_size;                 // NOLINT(build/unsigned)
+  std::chrono::microseconds m_wakeup_period;
+  std::atomic<uint64_t> m_scheduled_counter; // NOLINT(build/unsigned)
+
+  // Lateness against the schedule, and whether late events are dropped
+  HSIRateController m_rate_controller;
+  HSIThreadSettings m_thread_settings;
+
+  // Random event times instead of a fixed period
+  HSIArrivalProcess m_arrival_process;
+
+  // Trace replay
+  HSITraceReader m_trace_reader;
+  double m_trace_speed; // 0: as fast as possible
+  bool m_trace_loop;
+
+  // Runtime rate changes and load profiles
+  void set_active_rate(double rate);
+  void apply_load_profile(std::chrono::steady_clock::time_point now);
+  void log_profile_segment(std::chrono::steady_clock::time_point now);
+
+  HSILoadProfile m_load_profile;
+  std::atomic<bool> m_rate_overridden; // set by change_rate, stops the profile for the rest of the run
+  std::chrono::steady_clock::time_point m_profile_start_time;
+  std::size_t m_profile_segment;
+  uint64_t m_profile_cycle;       // NOLINT(build/unsigned)
+  uint64_t m_segment_start_count; // NOLINT(build/unsigned)
+  std::chrono::steady_clock::time_point m_segment_start_time;
+
+  // Achieved rate bookkeeping for opmon
+  uint64_t m_last_opmon_scheduled; // NOLINT(build/unsigned)
+  std::chrono::steady_clock::time_point m_last_opmon_time;
 };
 } // namespace hsilibs
 } // namespace dunedaq
@@ -8,6 +8,7 @@
  */
 
 #include "HSIController.hpp"
+#include "hsilibs/Issues.hpp"
 
 #include "timinglibs/TimingIssues.hpp"
 #include "timinglibs/timingcmd/Nljs.hpp"
@@ -23,6 +24,7 @@
 
 #include <chrono>
 #include <cstdlib>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
@@ -34,8 +36,18 @@ namespace hsilibs {
 HSIController::HSIController(const std::string& name)
   : dunedaq::timinglibs::TimingEndpointControllerBase(name, 9) // 2nd arg: how many hw commands can this module send?
   , m_endpoint_state(0)
+  , m_hsi_settings{ 0, 0, 0, 0, 0.0 }
+  , m_hsi_running(false)
   , m_control_hardware_io(false)
-  , m_clock_frequency(62.5e6)
+  , m_batch_hardware_commands(false)
+  , m_dump_device_info(false)
+  , m_warm_reconfigure(false)
+  , m_applied_trigger_rate(0.0)
+  , m_monitoring_period(500)
+  , m_monitoring_max_defer(100)
+  , m_start_ready_timeout(2000)
+  , m_readiness_callback_id(-1)
+  , m_clock_frequency(0)
   , m_thread(std::bind(&HSIController::gather_monitor_data, this, std::placeholders::_1))
 {
   // this controller talks to the hw directly
@@ -52,6 +64,7 @@ HSIController::HSIController(const std::string& name)
   //register_command("hsi_start", &HSIController::do_hsi_start);
   //register_command("hsi_stop", &HSIController::do_hsi_stop);
   //register_command("hsi_print_status", &HSIController::do_hsi_print_status);
+  register_command("hsi_update_masks", &HSIController::do_hsi_update_masks);
 }
 
 void
@@ -68,18 +81,45 @@ HSIController::do_configure(const nlohmann::json& data)
   TimingController::do_configure(data);
 
   m_control_hardware_io = m_hsi_configuration->get_control_hardware_io();
+  m_batch_hardware_commands = m_hsi_configuration->get_batch_hardware_commands();
+  m_dump_device_info = m_hsi_configuration->get_dump_device_info();
+  m_warm_reconfigure = m_hsi_configuration->get_warm_reconfigure();
+  m_monitoring_max_defer = std::chrono::milliseconds(m_hsi_configuration->get_monitoring_max_defer_ms());
+  m_start_ready_timeout = std::chrono::milliseconds(m_hsi_configuration->get_start_ready_timeout_ms());
+  m_thread_settings = HSIThreadSettings::from_conf(m_hsi_configuration->get_thread_conf());
+  {
+    std::lock_guard<std::mutex> lock(m_hsi_settings_mutex);
+    m_hsi_settings.data_source = m_hsi_configuration->get_data_source();
+    m_hsi_settings.rising_edge_mask = m_hsi_configuration->get_rising_edge_mask();
+    m_hsi_settings.falling_edge_mask = m_hsi_configuration->get_falling_edge_mask();
+    m_hsi_settings.invert_edge_mask = m_hsi_configuration->get_invert_edge_mask();
+    m_hsi_settings.trigger_rate = m_hsi_configuration->get_trigger_rate();
+  }
 
   configure_uhal(m_hsi_configuration); // configure hw ipbus connection
 
   try
   {
-    m_hsi_device = std::make_unique<uhal::HwInterface>(m_connection_manager->getDevice(m_timing_device));
+    auto shared_device =
+      HSIDeviceRegistry::get().acquire(m_hsi_configuration->get_connections_file(), m_timing_device, [this]() {
+        return std::make_shared<uhal::HwInterface>(m_connection_manager->getDevice(m_timing_device));
+      });
+    m_hsi_device = shared_device.hw;
+    m_hsi_scheduler = shared_device.scheduler;
+    m_readiness = shared_device.readiness;
   } catch (const uhal::exception::ConnectionUIDDoesNotExist& exception) {
     std::stringstream message;
     message << "UHAL device name not " << m_timing_device << " in connections file";
     throw timinglibs::UHALDeviceNameIssue(ERS_HERE, message.str(), exception);
   }
 
+  // readers may trust a readback for one monitoring cycle, including the time it can be deferred
+  m_readiness->set_update_period(m_monitoring_period + m_monitoring_max_defer);
+  m_readiness_callback_id = m_readiness->subscribe([this](bool ready, HSIReadinessTracker::clock_t::time_point) {
+    TLOG_DEBUG(2) << "HSI device " << (ready ? "became ready" : "no longer ready") << "; ready transitions: "
+                  << m_readiness->became_ready() << ", not ready transitions: " << m_readiness->became_not_ready();
+  });
+
   m_thread.start_working_thread("gather-hsi-info");
 
   configure_hardware_or_recover_state<timinglibs::TimingEndpointNotReady>(data, "HSI endpoint", m_endpoint_state.load());
@@ -91,6 +131,9 @@ void
 HSIController::do_start(const nlohmann::json& data)
 {
   TimingController::do_start(data); // set sent cmd counters to 0
+  if (!m_readiness->wait_for(true, m_start_ready_timeout)) {
+    ers::warning(HSIDeviceNotReadyAtStart(ERS_HERE, m_timing_device, m_start_ready_timeout.count()));
+  }
   do_hsi_start(data);
 }
 
@@ -104,17 +147,35 @@ void
 HSIController::do_scrap(const nlohmann::json& data)
 {
   m_thread.stop_working_thread();
+  if (m_readiness) {
+    m_readiness->unsubscribe(m_readiness_callback_id);
+    m_readiness->reset();
+  }
+  m_readiness.reset();
+  m_hsi_device.reset();
+  m_hsi_scheduler.reset();
   scrap_uhal();
 
   m_timing_device="";
   m_control_hardware_io=false;
   m_endpoint_state = 0x0;
+  m_applied_trigger_rate = 0.0;
+  m_clock_frequency = 0;
 
   TimingController::do_scrap(data);
 }
 
 void
 HSIController::send_configure_hardware_commands(const nlohmann::json& data)
+{
+  if (m_warm_reconfigure && converge_hardware_state(data)) {
+    return;
+  }
+  send_full_configure_hardware_commands(data);
+}
+
+void
+HSIController::send_full_configure_hardware_commands(const nlohmann::json& data)
 {
   if (m_control_hardware_io)
   {
@@ -122,31 +183,91 @@ HSIController::send_configure_hardware_commands(const nlohmann::json& data)
     do_io_reset(data);
     m_thread.start_working_thread("gather-hsi-info");
   }
-  do_hsi_reset(data);
-  do_endpoint_reset(data);
-  do_hsi_configure();
+  if (m_batch_hardware_commands && do_hsi_configure_batched()) {
+    m_applied_trigger_rate = current_hsi_settings().trigger_rate;
+    return;
+  }
+
+  auto settings = current_hsi_settings();
+  if (settings.trigger_rate <= 0) {
+    throw timinglibs::InvalidTriggerRateValue(ERS_HERE, settings.trigger_rate);
+  }
+  TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " step by step hsi reset, endpoint reset and hsi configure";
+  {
+    HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
+    auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
+    hsi_configure_stepwise(design, m_managed_endpoint_id, m_hsi_configuration->get_address(), settings);
+  }
+  ++(m_sent_hw_command_counters.at(4).atomic);
+  ++(m_sent_hw_command_counters.at(3).atomic);
+  ++(m_sent_hw_command_counters.at(5).atomic);
+  m_applied_trigger_rate = settings.trigger_rate;
+}
+
+bool
+HSIController::converge_hardware_state(const nlohmann::json& data)
+{
+  auto start_time = std::chrono::steady_clock::now();
+  try {
+    auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
+
+    timing::timingfirmwareinfo::TimingDeviceInfo device_info;
+    {
+      HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
+      design->get_info(device_info);
+    }
+    auto& ept_info = device_info.endpoint_info;
+    auto& hsi_info = device_info.hsi_info;
+
+    auto settings = current_hsi_settings();
+    bool ept_good = ept_info.state == 0x8 && ept_info.ready;
+    bool masks_good = settings.matches(hsi_info);
+    bool buffer_good = hsi_info.buffer_enabled && !hsi_info.buffer_error && !hsi_info.buffer_warning;
+
+    // only the endpoint state changes what is sent; masks and buffer are rewritten and flushed below anyway,
+    // and the emulated rate is checked against the rate register by verify_hsi_configuration
+    TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " live state; ept good: " << ept_good
+                  << ", masks good: " << masks_good << ", buffer good: " << buffer_good;
+
+    if (!ept_good) {
+      // a lost endpoint needs the clocking and the endpoint brought back before the hsi block
+      if (m_control_hardware_io) {
+        m_thread.stop_working_thread();
+        do_io_reset(data);
+        m_thread.start_working_thread("gather-hsi-info");
+      }
+      do_endpoint_reset(data);
+    }
+    // the hsi reset is always sent: it flushes events buffered since the previous run, which must not
+    // reach the next one; what the warm path saves is the io and endpoint resets of a healthy endpoint
+    do_hsi_reset(data);
+    do_hsi_configure();
+
+    if (!verify_hsi_configuration(design)) {
+      return false;
+    }
+
+    TLOG_DEBUG(0) << get_name() << ": hardware state converged in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time)
+                       .count()
+                  << " us";
+    return true;
+  } catch (const std::exception& excpt) {
+    ers::warning(HSIConfigurationMismatch(ERS_HERE, m_timing_device, std::string("warm reconfigure failed: ") + excpt.what()));
+    return false;
+  }
 }
 
 void
 HSIController::do_io_reset(const nlohmann::json& )
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
 
   auto clock_config = m_hsi_configuration->get_clock_config();
-  if (m_hsi_configuration->get_soft()) {
-    TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " soft io reset";
-    design->soft_reset_io();
-  } else if (!clock_config.empty()) {
-    TLOG_DEBUG(0) << get_name() << ": " << m_timing_device
-                  << " io reset, with supplied clk file: " << clock_config;
-    design->reset_io(clock_config);
-  }
-  else
-  {
-    TLOG_DEBUG(0) << get_name() << ": " << m_timing_device
-                  << " io reset, with supplied clk source: " << m_hsi_configuration->get_clock_source();
-    design->reset_io(static_cast<timing::ClockSource>(m_hsi_configuration->get_clock_source()));
-  }
+  TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " io reset; soft: " << m_hsi_configuration->get_soft()
+                << ", clk file: " << clock_config << ", clk source: " << m_hsi_configuration->get_clock_source();
+  hsi_io_reset(design, m_hsi_configuration->get_soft(), clock_config, m_hsi_configuration->get_clock_source());
 
   ++(m_sent_hw_command_counters.at(0).atomic);
 }
@@ -154,6 +275,7 @@ HSIController::do_io_reset(const nlohmann::json& )
 void
 HSIController::do_endpoint_enable(const nlohmann::json& data)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   auto ept_address = m_hsi_configuration->get_address();
   TLOG_DEBUG(0) << "ept enable hw cmd; a: " << ept_address;
 
@@ -166,6 +288,7 @@ HSIController::do_endpoint_enable(const nlohmann::json& data)
 void
 HSIController::do_endpoint_disable(const nlohmann::json& data)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   TLOG_DEBUG(0) << "ept disable hw cmd";
 
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
@@ -176,6 +299,7 @@ HSIController::do_endpoint_disable(const nlohmann::json& data)
 void
 HSIController::do_endpoint_reset(const nlohmann::json& data)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   auto ept_address = m_hsi_configuration->get_address();
   TLOG_DEBUG(0) << "ept reset hw cmd; a: " << ept_address;
 
@@ -187,6 +311,7 @@ HSIController::do_endpoint_reset(const nlohmann::json& data)
 void
 HSIController::do_hsi_reset(const nlohmann::json&)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " hsi reset";
 
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
@@ -198,19 +323,21 @@ void
 HSIController::do_hsi_configure()
 {
   TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << ", hsi configure";
-  auto random_rate = m_hsi_configuration->get_trigger_rate();
+  auto random_rate = current_hsi_settings().trigger_rate;
   do_hsi_configure(random_rate);
 }
 
 void
 HSIController::do_hsi_configure(double random_rate)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " hsi configure";
 
-  auto data_source = m_hsi_configuration->get_data_source();
-  auto rising_edge_mask = m_hsi_configuration->get_rising_edge_mask();
-  auto falling_edge_mask = m_hsi_configuration->get_falling_edge_mask();
-  auto invert_edge_mask = m_hsi_configuration->get_invert_edge_mask();
+  auto settings = current_hsi_settings();
+  auto data_source = settings.data_source;
+  auto rising_edge_mask = settings.rising_edge_mask;
+  auto falling_edge_mask = settings.falling_edge_mask;
+  auto invert_edge_mask = settings.invert_edge_mask;
 
   if (random_rate <= 0) {
     throw timinglibs::InvalidTriggerRateValue(ERS_HERE, random_rate);
@@ -223,31 +350,108 @@ HSIController::do_hsi_configure(double random_rate)
   design->configure_hsi(
     data_source, rising_edge_mask, falling_edge_mask, invert_edge_mask, random_rate);
   ++(m_sent_hw_command_counters.at(5).atomic);
+  m_applied_trigger_rate = random_rate;
+}
+
+bool
+HSIController::do_hsi_configure_batched()
+{
+  TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " batched hsi reset, endpoint reset and hsi configure";
+
+  auto settings = current_hsi_settings();
+  auto random_rate = settings.trigger_rate;
+  if (random_rate <= 0) {
+    throw timinglibs::InvalidTriggerRateValue(ERS_HERE, random_rate);
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  try {
+    HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
+    auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
+    // read before queueing anything: the read dispatches
+    auto clock = clock_frequency(design);
+
+    hsi_configure_batched(
+      *m_hsi_device, design, m_managed_endpoint_id, m_hsi_configuration->get_address(), settings, clock);
+    ++(m_sent_hw_command_counters.at(4).atomic);
+    ++(m_sent_hw_command_counters.at(3).atomic);
+    ++(m_sent_hw_command_counters.at(5).atomic);
+    m_applied_trigger_rate = random_rate;
+
+    bool verified = verify_hsi_configuration(design);
+    TLOG_DEBUG(0) << get_name() << ": batched hsi configure took "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time)
+                       .count()
+                  << " us, readback " << (verified ? "ok" : "mismatch");
+    return verified;
+  } catch (const std::exception& excpt) {
+    ers::warning(HSIConfigurationMismatch(ERS_HERE, m_timing_device, std::string("batched configure failed: ") + excpt.what()));
+    return false;
+  }
+}
+
+uint64_t // NOLINT(build/unsigned)
+HSIController::clock_frequency(const timing::HSIDesignInterface* design)
+{
+  // a property of the firmware: read once per configuration
+  if (m_clock_frequency == 0) {
+    m_clock_frequency = read_hsi_clock_frequency(design);
+  }
+  return m_clock_frequency;
+}
+
+bool
+HSIController::verify_hsi_configuration(const timing::HSIDesignInterface* design)
+{
+  return verify_hsi_configuration(design, current_hsi_settings());
+}
+
+bool
+HSIController::verify_hsi_configuration(const timing::HSIDesignInterface* design, const HSISettings& settings)
+{
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
+  auto mismatches = hsi_configuration_mismatches(design, settings, clock_frequency(design));
+  if (!mismatches.empty()) {
+    ers::warning(HSIConfigurationMismatch(ERS_HERE, m_timing_device, mismatches));
+    return false;
+  }
+  return true;
 }
 
 void
 HSIController::do_hsi_start(const nlohmann::json&)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
    TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " hsi start";
 
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
-  design->get_hsi_node().start_hsi();
+  auto& hsi_node = design->get_hsi_node();
+  if (!m_batch_hardware_commands) {
+    hsi_node.start_hsi();
+  } else if (!hsi_start_batched(hsi_node)) {
+    ers::warning(HSIConfigurationMismatch(ERS_HERE, m_timing_device, "hsi block not enabled after batched start, starting again"));
+    hsi_node.start_hsi();
+  }
   ++(m_sent_hw_command_counters.at(6).atomic);
+  m_hsi_running = true;
 }
 
 void
 HSIController::do_hsi_stop(const nlohmann::json&)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " hsi stop";
 
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
   design->get_hsi_node().stop_hsi();
   ++(m_sent_hw_command_counters.at(7).atomic);
+  m_hsi_running = false;
 }
 
 void
 HSIController::do_hsi_print_status(const nlohmann::json&)
 {
+  HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
   TLOG_DEBUG(0) << get_name() << ": " << m_timing_device << " hsi print status";
 
   auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
@@ -255,6 +459,96 @@ HSIController::do_hsi_print_status(const nlohmann::json&)
   ++(m_sent_hw_command_counters.at(8).atomic);
 }
 
+HSISettings
+HSIController::current_hsi_settings() const
+{
+  std::lock_guard<std::mutex> lock(m_hsi_settings_mutex);
+  return m_hsi_settings;
+}
+
+void
+HSIController::do_hsi_update_masks(const nlohmann::json& args)
+{
+  auto current = current_hsi_settings();
+  auto requested = current;
+  requested.data_source = args.value("data_source", current.data_source);
+  requested.rising_edge_mask = args.value("rising_edge_mask", current.rising_edge_mask);
+  requested.falling_edge_mask = args.value("falling_edge_mask", current.falling_edge_mask);
+  requested.invert_edge_mask = args.value("invert_edge_mask", current.invert_edge_mask);
+  requested.trigger_rate = args.value("trigger_rate", current.trigger_rate);
+
+  if (!m_hsi_device) {
+    throw InvalidHSIMaskUpdate(ERS_HERE, m_timing_device, "controller is not configured");
+  }
+  if (requested.data_source > 1) {
+    throw InvalidHSIMaskUpdate(ERS_HERE, m_timing_device, "unknown data source " + std::to_string(requested.data_source));
+  }
+  if (requested.trigger_rate <= 0) {
+    throw InvalidHSIMaskUpdate(ERS_HERE, m_timing_device, "trigger rate must be positive");
+  }
+
+  // switching between real and emulated signals while enabled would leave events from both in the buffer
+  bool restart = m_hsi_running.load() && requested.data_source != current.data_source;
+
+  TLOG() << get_name() << ": " << m_timing_device << " updating hsi masks; source: " << requested.data_source
+         << std::hex << ", rising: 0x" << requested.rising_edge_mask << ", falling: 0x" << requested.falling_edge_mask
+         << ", invert: 0x" << requested.invert_edge_mask << std::dec << ", rate: " << requested.trigger_rate
+         << (restart ? ", with hsi stop/start" : "");
+
+  auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
+  // one dispatch, so the readout sees the old or the new masks and never a mix of the two
+  auto write_settings = [&](const HSISettings& settings, double trigger_rate) {
+    HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kControl);
+    auto& hsi_node = design->get_hsi_node();
+    auto clock = clock_frequency(design);
+
+    if (restart) {
+      hsi_node.stop_hsi(false);
+      ++(m_sent_hw_command_counters.at(7).atomic);
+    }
+    hsi_node.configure_hsi(settings.data_source,
+                           settings.rising_edge_mask,
+                           settings.falling_edge_mask,
+                           settings.invert_edge_mask,
+                           trigger_rate,
+                           clock,
+                           false);
+    ++(m_sent_hw_command_counters.at(5).atomic);
+    if (restart) {
+      hsi_node.start_hsi(false);
+      ++(m_sent_hw_command_counters.at(6).atomic);
+    }
+    m_hsi_device->dispatch();
+    m_applied_trigger_rate = trigger_rate;
+  };
+
+  // what the hardware runs now; the emulated rate may differ from the configured one (random rate changes)
+  double previous_rate = m_applied_trigger_rate > 0 ? m_applied_trigger_rate : current.trigger_rate;
+  std::string failure;
+  try {
+    write_settings(requested, requested.trigger_rate);
+    // the requested settings only become the configured ones once the hardware reads them back
+    if (verify_hsi_configuration(design, requested)) {
+      std::lock_guard<std::mutex> lock(m_hsi_settings_mutex);
+      m_hsi_settings = requested;
+      return;
+    }
+    failure = "hardware readback differs from the requested settings";
+  } catch (const std::exception& excpt) {
+    failure = std::string("hardware write failed: ") + excpt.what();
+  }
+
+  // put the hardware back to the settings monitoring and warm reconfigure compare against
+  try {
+    write_settings(current, previous_rate);
+    failure += ", previous settings restored";
+  } catch (const std::exception& excpt) {
+    m_applied_trigger_rate = 0.0;
+    failure += std::string(", restoring the previous settings failed too: ") + excpt.what();
+  }
+  throw InvalidHSIMaskUpdate(ERS_HERE, m_timing_device, failure);
+}
+
 //void
 //HSIController::get_info(opmonlib::InfoCollector& ci, int /*level*/)
 //{
@@ -277,10 +571,15 @@ HSIController::do_hsi_print_status(const nlohmann::json&)
 void
 HSIController::process_device_info(nlohmann::json info)
 {
-  ++m_device_infos_received_count;
-
   timing::timingfirmwareinfo::TimingDeviceInfo device_info;
   from_json(info, device_info);
+  process_device_info(device_info);
+}
+
+void
+HSIController::process_device_info(const timing::timingfirmwareinfo::TimingDeviceInfo& device_info)
+{
+  ++m_device_infos_received_count;
 
   auto ept_info = device_info.endpoint_info;
   m_endpoint_state = device_info.endpoint_info.state;
@@ -288,64 +587,50 @@ HSIController::process_device_info(nlohmann::json info)
 
   bool ept_good = (m_endpoint_state == 0x8) && ready;
 
-  auto hsi_info = device_info.hsi_info;
+  auto& hsi_info = device_info.hsi_info;
   auto buffer_enabled = hsi_info.buffer_enabled;
   auto buffer_error = hsi_info.buffer_error;
   auto buffer_warning = hsi_info.buffer_warning;
-  auto re_mask = hsi_info.re_mask;
-  auto fe_mask = hsi_info.fe_mask;
-  auto inv_mask = hsi_info.inv_mask;
-  auto data_source = hsi_info.source;
 
-  bool hsi_good = buffer_enabled && !buffer_error && !buffer_warning
-                  && re_mask == m_hsi_configuration->get_rising_edge_mask()
-                  && fe_mask == m_hsi_configuration->get_falling_edge_mask()
-                  && inv_mask == m_hsi_configuration->get_invert_edge_mask()
-                  && data_source == m_hsi_configuration->get_data_source();
+  bool hsi_good = buffer_enabled && !buffer_error && !buffer_warning && current_hsi_settings().matches(hsi_info);
 
   TLOG_DEBUG(0) << "EPT good: " << ept_good << ", HSI good: " << hsi_good << ", infos received: " << m_device_infos_received_count;
 
-  TLOG_DEBUG(0) << "device data: " << info.dump();
-
-  if (ept_good && hsi_good)
-  {
-    if (!m_device_ready)
-    {
-      m_device_ready = true;
-      TLOG_DEBUG(2) << "HSI device became ready";
-    }
-  }
-  else
-  {
-    if (m_device_ready)
-    {
-      m_device_ready = false;
-      TLOG_DEBUG(2) << "HSI device no longer ready";
-    }
+  if (m_dump_device_info) {
+    nlohmann::json info;
+    to_json(info, device_info);
+    TLOG_DEBUG(0) << "device data: " << info.dump();
   }
+
+  // transitions are logged by the callback registered at configure
+  m_device_ready = ept_good && hsi_good;
+  m_readiness->update(ept_good && hsi_good);
 }
 
 void
 HSIController::gather_monitor_data(std::atomic<bool>& running_flag)
 {
+  apply_thread_settings(get_name() + "/gather-hsi-info", m_thread_settings);
+
   while (running_flag.load()) {
 
     timing::timingfirmwareinfo::TimingDeviceInfo device_info;
     // collect the data from the hardware
     try
     {
+      // low priority: waits for a gap between readout polls of the same device
+      HSITransactionScheduler::Section section(
+        *m_hsi_scheduler, HSITransactionScheduler::Priority::kMonitoring, m_monitoring_max_defer);
       auto design = dynamic_cast<const timing::HSIDesignInterface*>(&m_hsi_device->getNode(""));
       design->get_info(device_info);
     } catch (const std::exception& excpt) {
       ers::warning(timinglibs::FailedToCollectOpMonInfo(ERS_HERE, m_timing_device, excpt));
     }
 
-    nlohmann::json info;
-    to_json(info, device_info);
-    process_device_info(info);
+    process_device_info(device_info);
 
     auto prev_gather_time = std::chrono::steady_clock::now();
-    auto next_gather_time = prev_gather_time + std::chrono::milliseconds(500);
+    auto next_gather_time = prev_gather_time + m_monitoring_period;
 
     // check running_flag periodically
     auto slice_period = std::chrono::microseconds(10000);
@@ -12,18 +12,27 @@
 #ifndef HSILIBS_PLUGINS_HSICONTROLLER_HPP_
 #define HSILIBS_PLUGINS_HSICONTROLLER_HPP_
 
+#include "HSIDeviceRegistry.hpp"
+#include "HSIHardwareSequence.hpp"
+#include "HSIThreadTuning.hpp"
 #include "hsilibs/dal/HSIControllerConf.hpp"
 #include "hsilibs/dal/HSIController.hpp"
 
 #include "timinglibs/TimingEndpointControllerBase.hpp"
 #include "timinglibs/TimingHardwareInterface.hpp"
 
+#include "timing/HSIDesignInterface.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
 #include "appfwk/DAQModule.hpp"
 #include "ers/Issue.hpp"
 #include "logging/Logging.hpp"
 #include "utilities/WorkerThread.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -52,8 +61,26 @@ public:
 protected:
   const hsilibs::dal::HSIControllerConf* m_hsi_configuration;
 
-  std::unique_ptr<uhal::HwInterface> m_hsi_device;
+  // what the hsi block is meant to be programmed with; starts from the configuration, changed by hsi_update_masks
+  HSISettings m_hsi_settings;
+  mutable std::mutex m_hsi_settings_mutex;
+  HSISettings current_hsi_settings() const;
+  std::atomic<bool> m_hsi_running;
+
+  // shared with any other module of this process that talks to the same device
+  std::shared_ptr<uhal::HwInterface> m_hsi_device;
+  std::shared_ptr<HSITransactionScheduler> m_hsi_scheduler;
+  std::shared_ptr<HSIReadinessTracker> m_readiness;
   bool m_control_hardware_io;
+  bool m_batch_hardware_commands;
+  bool m_dump_device_info;
+  bool m_warm_reconfigure;
+  double m_applied_trigger_rate; // emulated rate last written to the hsi block; not part of the status readback
+  std::chrono::milliseconds m_monitoring_period;
+  std::chrono::milliseconds m_monitoring_max_defer;
+  std::chrono::milliseconds m_start_ready_timeout;
+  int m_readiness_callback_id;
+  HSIThreadSettings m_thread_settings;
 
   dunedaq::utilities::WorkerThread m_thread;
   void gather_monitor_data(std::atomic<bool>&);
@@ -64,6 +91,9 @@ protected:
   void do_stop(const nlohmann::json& data) override;
   void do_scrap(const nlohmann::json& data) override;
   void send_configure_hardware_commands(const nlohmann::json& data) override;
+  void send_full_configure_hardware_commands(const nlohmann::json& data);
+  // read back the live state and send only the steps needed to reach the configured one; false if that did not work
+  bool converge_hardware_state(const nlohmann::json& data);
 
   // overriding these to talk directly to hw
   void do_io_reset(const nlohmann::json& data) override;
@@ -80,8 +110,19 @@ protected:
 
   void do_hsi_print_status(const nlohmann::json&);
 
+  // runtime change of the edge masks, data source and emulated rate, written in a single dispatch
+  void do_hsi_update_masks(const nlohmann::json& args);
+
+  // hsi reset, endpoint reset and hsi configure with the fewest dispatches; false if the readback disagrees
+  bool do_hsi_configure_batched();
+  bool verify_hsi_configuration(const timing::HSIDesignInterface* design);
+  bool verify_hsi_configuration(const timing::HSIDesignInterface* design, const HSISettings& settings);
+  // firmware clock frequency of the design, as used by its own configure_hsi
+  uint64_t clock_frequency(const timing::HSIDesignInterface* design); // NOLINT(build/unsigned)
+
   // op mon info
   void process_device_info(nlohmann::json info) override;
+  void process_device_info(const timing::timingfirmwareinfo::TimingDeviceInfo& device_info);
 
   std::atomic<uint> m_endpoint_state;
   uint64_t m_clock_frequency;                     // NOLINT(build/unsigned)
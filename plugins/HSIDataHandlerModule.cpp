@@ -9,15 +9,19 @@
 #include "HSIDataHandlerModule.hpp"
 
 #include "hsilibs/Types.hpp"
+#include "hsilibs/dal/HSIDataHandlerConf.hpp"
+#include "hsilibs/opmon/capture_info.pb.h"
 #include "HSIFrameProcessor.hpp"
+#include "HSILatencyBuffer.hpp"
+#include "HSIRequestHandler.hpp"
 
 #include "datahandlinglibs/concepts/DataHandlingConcept.hpp"
 #include "datahandlinglibs/models/DataHandlingModel.hpp"
-#include "datahandlinglibs/models/BinarySearchQueueModel.hpp"
-#include "datahandlinglibs/models/DefaultRequestHandlerModel.hpp"
 #include "datahandlinglibs/ReadoutLogging.hpp"
 
 #include "appfwk/cmd/Nljs.hpp"
+#include "confmodel/DetectorConfig.hpp"
+#include "confmodel/Session.hpp"
 #include "logging/Logging.hpp"
 #include "rcif/cmd/Nljs.hpp"
 
@@ -34,6 +38,9 @@ namespace hsilibs {
 HSIDataHandlerModule::HSIDataHandlerModule(const std::string& name)
   : DAQModule(name)
   , m_configured(false)
+  , m_dal(nullptr)
+  , m_clock_frequency(62500000)
+  , m_capture_mode("disabled")
   , m_readout_impl(nullptr)
   , m_run_marker{ false }
 {
@@ -50,19 +57,16 @@ HSIDataHandlerModule::init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg)
 
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering init() method";
   
-  namespace rol = dunedaq::datahandlinglibs;
-
-  m_readout_impl = std::make_unique<rol::DataHandlingModel<
-                    hsilibs::HSI_FRAME_STRUCT,
-                    rol::DefaultRequestHandlerModel<hsilibs::HSI_FRAME_STRUCT, rol::BinarySearchQueueModel<hsilibs::HSI_FRAME_STRUCT>>,
-                    rol::BinarySearchQueueModel<hsilibs::HSI_FRAME_STRUCT>,
-                    hsilibs::HSIFrameProcessor>>(m_run_marker);
-  m_readout_impl->init(mcfg->module<appmodel::DataHandlerModule>(get_name()));
+  m_readout_impl = std::make_shared<HSIDataHandlingModel>(m_run_marker);
+  m_dal = mcfg->module<appmodel::DataHandlerModule>(get_name());
+  m_clock_frequency = mcfg->configuration_manager()->session()->get_detector_configuration()->get_clock_speed_hz();
+  m_readout_impl->init(m_dal);
   if (m_readout_impl == nullptr)
   {
     TLOG() << get_name() << "Initialize HSIDataHandlerModule FAILED! ";
     throw datahandlinglibs::FailedReadoutInitialization(ERS_HERE, get_name(), "OKS Config"); // 4 json ident
   }
+  register_node(get_name(), m_readout_impl);
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting init() method";
 }
 
@@ -72,10 +76,64 @@ HSIDataHandlerModule::init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg)
 //   m_readout_impl->get_info(ci, level);
 // }
 
+void
+HSIDataHandlerModule::generate_opmon_data()
+{
+  std::shared_ptr<HSICaptureWriter> capture_writer;
+  {
+    std::lock_guard<std::mutex> lock(m_capture_writer_mutex);
+    capture_writer = m_capture_writer;
+  }
+  if (capture_writer == nullptr) {
+    return;
+  }
+  auto stats = capture_writer->get_stats();
+  opmon::HSICaptureInfo info;
+  info.set_capturing(capture_writer->is_open());
+  info.set_frames_written(stats.frames_written);
+  info.set_bytes_written(stats.bytes_written);
+  info.set_frames_dropped(stats.frames_dropped);
+  info.set_files_opened(stats.files_opened);
+  info.set_write_errors(stats.write_errors);
+  info.set_max_write_latency_us(stats.max_write_latency_us);
+  info.set_free_buffers(stats.free_buffers);
+  publish(std::move(info));
+}
+
+void
+HSIDataHandlerModule::create_capture_writer()
+{
+  auto hsi_conf = m_dal->get_module_configuration()->cast<dal::HSIDataHandlerConf>();
+  m_capture_mode = hsi_conf != nullptr ? hsi_conf->get_capture_mode() : "disabled";
+  if (m_capture_mode == "disabled") {
+    return;
+  }
+
+  HSICaptureWriter::Config config;
+  config.directory = hsi_conf->get_capture_directory();
+  config.file_prefix = hsi_conf->get_capture_file_prefix();
+  config.max_file_size_bytes = static_cast<uint64_t>(hsi_conf->get_capture_file_size_mb()) << 20; // NOLINT(build/unsigned)
+  config.max_files = hsi_conf->get_capture_max_files();
+  config.buffer_size_bytes = static_cast<std::size_t>(hsi_conf->get_capture_buffer_size_kb()) << 10;
+  config.num_buffers = hsi_conf->get_capture_num_buffers();
+  config.io_threads = hsi_conf->get_capture_io_threads();
+  config.use_io_uring = hsi_conf->get_capture_use_io_uring();
+  config.direct_io = hsi_conf->get_capture_direct_io();
+
+  auto capture_writer = std::make_shared<HSICaptureWriter>(config);
+  TLOG() << get_name() << ": raw HSI capture (" << m_capture_mode << " mode) into " << config.directory << " using "
+         << capture_writer->backend_name();
+  std::lock_guard<std::mutex> lock(m_capture_writer_mutex);
+  m_capture_writer = std::move(capture_writer);
+}
+
 void
 HSIDataHandlerModule::do_conf(const data_t& args)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_conf() method";
+  create_capture_writer();
+  // the frame processor adds its capture task in conf() if it has a writer
+  m_readout_impl->set_capture_writer(m_capture_writer);
   m_readout_impl->conf(args);
   m_configured = true;
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_conf() method";
@@ -86,6 +144,10 @@ HSIDataHandlerModule::do_scrap(const data_t& args)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
   m_readout_impl->scrap(args);
+  {
+    std::lock_guard<std::mutex> lock(m_capture_writer_mutex);
+    m_capture_writer.reset();
+  }
   m_configured = false;
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
 }
@@ -93,11 +155,15 @@ void
 HSIDataHandlerModule::do_start(const data_t& args)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_start() method";
-  m_run_marker.store(true);
-  m_readout_impl->start(args);
-
   rcif::cmd::StartParams start_params = args.get<rcif::cmd::StartParams>();
   m_run_number = start_params.run;
+
+  if (m_capture_writer != nullptr && m_capture_mode == "run") {
+    m_capture_writer->open(m_run_number, m_clock_frequency);
+  }
+
+  m_run_marker.store(true);
+  m_readout_impl->start(args);
   TLOG() << get_name() << " successfully started for run number " << m_run_number;
 
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_start() method";
@@ -109,6 +175,9 @@ HSIDataHandlerModule::do_stop(const data_t& args)
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_stop() method";
   m_run_marker.store(false);
   m_readout_impl->stop(args);
+  if (m_capture_writer != nullptr) {
+    m_capture_writer->close();
+  }
   TLOG() << get_name() << " successfully stopped for run number " << m_run_number;
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_stop() method";
 }
@@ -117,7 +186,16 @@ void
 HSIDataHandlerModule::do_record(const data_t& args)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_issue_recording() method";
-  m_readout_impl->record(args);
+  if (m_capture_writer != nullptr && m_capture_mode == "record") {
+    // HSI frames are tiny and sparse: capture them from the processor rather than
+    // dumping the latency buffer, so request serving is not disturbed
+    auto duration = std::chrono::seconds(args.value("duration", 0));
+    if (m_capture_writer->open(m_run_number, m_clock_frequency) && duration.count() > 0) {
+      m_capture_writer->close_after(duration);
+    }
+  } else {
+    m_readout_impl->record(args);
+  }
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_issue_recording() method";
 }
 
@@ -9,12 +9,17 @@
 #ifndef HSILIBS_PLUGINS_HSIDATALINKHANDLER_HPP_
 #define HSILIBS_PLUGINS_HSIDATALINKHANDLER_HPP_
 
+#include "HSICaptureWriter.hpp"
+#include "HSIDataHandlingModel.hpp"
+
 #include "appfwk/DAQModule.hpp"
+#include "appmodel/DataHandlerModule.hpp"
 #include "daqdataformats/Types.hpp"
 #include "datahandlinglibs/concepts/DataHandlingConcept.hpp"
 
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <atomic>
@@ -39,6 +44,9 @@ public:
   void init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg) override;
   //  void get_info(opmonlib::InfoCollector& ci, int level) override;
 
+protected:
+  void generate_opmon_data() override;
+
 private:
   // Commands
   void do_conf(const data_t& /*args*/);
@@ -50,9 +58,17 @@ private:
   // Configuration
   bool m_configured;
   daqdataformats::run_number_t m_run_number;
+  const appmodel::DataHandlerModule* m_dal;
+  uint64_t m_clock_frequency; // NOLINT(build/unsigned)
+
+  // Raw frame capture
+  void create_capture_writer();
+  std::string m_capture_mode;
+  std::shared_ptr<HSICaptureWriter> m_capture_writer;
+  std::mutex m_capture_writer_mutex; // commands replace the writer while opmon reads it
 
   // Internal
-  std::unique_ptr<datahandlinglibs::DataHandlingConcept> m_readout_impl;
+  std::shared_ptr<HSIDataHandlingModel> m_readout_impl;
 
   // Threading
   std::atomic<bool> m_run_marker;
@@ -0,0 +1,359 @@
+/**
+ * @file HSIMultiEndpointController.cpp HSIMultiEndpointController class
+ * implementation
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "HSIMultiEndpointController.hpp"
+#include "hsilibs/Issues.hpp"
+#include "hsilibs/opmon/multi_endpoint_controller_info.pb.h"
+
+#include "timinglibs/TimingIssues.hpp"
+
+#include "ers/Issue.hpp"
+#include "logging/Logging.hpp"
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+HSIMultiEndpointController::HSIMultiEndpointController(const std::string& name)
+  : dunedaq::appfwk::DAQModule(name)
+  , m_configuration(nullptr)
+  , m_thread(std::bind(&HSIMultiEndpointController::monitor_endpoints, this, std::placeholders::_1))
+  , m_monitoring_period(500)
+  , m_monitoring_max_defer(100)
+  , m_start_ready_timeout(2000)
+{
+  register_command("conf", &HSIMultiEndpointController::do_configure);
+  register_command("start", &HSIMultiEndpointController::do_start);
+  register_command("stop_trigger_sources", &HSIMultiEndpointController::do_stop);
+  register_command("scrap", &HSIMultiEndpointController::do_scrap);
+}
+
+void
+HSIMultiEndpointController::init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg)
+{
+  auto mod_config = mcfg->module<hsilibs::dal::HSIMultiEndpointController>(get_name());
+  m_configuration = mod_config->get_configuration();
+}
+
+const timing::HSIDesignInterface*
+HSIMultiEndpointController::Endpoint::design() const
+{
+  return dynamic_cast<const timing::HSIDesignInterface*>(&device.hw->getNode(""));
+}
+
+void
+HSIMultiEndpointController::do_configure(const nlohmann::json&)
+{
+  m_monitoring_period = std::chrono::milliseconds(m_configuration->get_monitoring_period_ms());
+  m_monitoring_max_defer = std::chrono::milliseconds(m_configuration->get_monitoring_max_defer_ms());
+  m_start_ready_timeout = std::chrono::milliseconds(m_configuration->get_start_ready_timeout_ms());
+  m_thread_settings = HSIThreadSettings::from_conf(m_configuration->get_thread_conf());
+
+  // a conf without a scrap in between starts from scratch
+  if (m_thread.thread_running()) {
+    m_thread.stop_working_thread();
+  }
+  release_endpoints();
+
+  // io and hsi resets act on the whole device: one endpoint entry per device
+  std::set<std::string> device_names;
+  for (auto endpoint_conf : m_configuration->get_endpoints()) {
+    if (!device_names.insert(endpoint_conf->get_device()).second) {
+      throw HSIEndpointCommandFailed(
+        ERS_HERE, endpoint_conf->get_device(), "conf", "the device is configured by more than one HSIEndpointConf");
+    }
+  }
+
+  configure_uhal(m_configuration); // configure hw ipbus connection
+
+  try {
+    configure_endpoints();
+  } catch (...) {
+    // leave nothing subscribed or acquired behind
+    release_endpoints();
+    scrap_uhal();
+    throw;
+  }
+
+  m_thread.start_working_thread("gather-hsi-multi");
+
+  TLOG() << get_name() << " conf done for " << m_endpoints.size() << " hsi endpoints";
+}
+
+void
+HSIMultiEndpointController::configure_endpoints()
+{
+  for (auto endpoint_conf : m_configuration->get_endpoints()) {
+    auto device_name = endpoint_conf->get_device();
+    auto endpoint = std::make_unique<Endpoint>();
+    endpoint->conf = endpoint_conf;
+    try {
+      endpoint->device =
+        HSIDeviceRegistry::get().acquire(m_configuration->get_connections_file(), device_name, [&]() {
+          return std::make_shared<uhal::HwInterface>(m_connection_manager->getDevice(device_name));
+        });
+    } catch (const uhal::exception::ConnectionUIDDoesNotExist& exception) {
+      std::stringstream message;
+      message << "UHAL device name not " << device_name << " in connections file";
+      throw timinglibs::UHALDeviceNameIssue(ERS_HERE, message.str(), exception);
+    }
+    endpoint->readiness_callback_id = endpoint->device.readiness->subscribe(
+      [this, device_name](bool ready, HSIReadinessTracker::clock_t::time_point) {
+        TLOG_DEBUG(2) << get_name() << ": HSI endpoint " << device_name << (ready ? " became ready" : " no longer ready");
+      });
+    std::lock_guard<std::mutex> lock(m_endpoints_mutex);
+    m_endpoints.push_back(std::move(endpoint));
+  }
+
+  // the status thread reads the endpoints back one after the other, each readback may be deferred
+  for (auto& endpoint : m_endpoints) {
+    endpoint->device.readiness->set_update_period(m_monitoring_period +
+                                                  m_monitoring_max_defer * static_cast<int>(m_endpoints.size()));
+  }
+
+  // the status thread is only started afterwards: an io reset must not race a readback
+  for_each_endpoint_parallel("conf", [this](Endpoint& endpoint) { configure_endpoint(endpoint); });
+}
+
+void
+HSIMultiEndpointController::release_endpoints()
+{
+  for (auto& endpoint : m_endpoints) {
+    endpoint->device.readiness->unsubscribe(endpoint->readiness_callback_id);
+    endpoint->device.readiness->reset();
+  }
+  std::lock_guard<std::mutex> lock(m_endpoints_mutex);
+  m_endpoints.clear();
+}
+
+void
+HSIMultiEndpointController::do_start(const nlohmann::json&)
+{
+  for_each_endpoint_parallel("start", [this](Endpoint& endpoint) { start_endpoint(endpoint); });
+}
+
+void
+HSIMultiEndpointController::do_stop(const nlohmann::json&)
+{
+  for_each_endpoint_parallel("stop", [this](Endpoint& endpoint) { stop_endpoint(endpoint); });
+}
+
+void
+HSIMultiEndpointController::do_scrap(const nlohmann::json&)
+{
+  if (m_thread.thread_running()) {
+    m_thread.stop_working_thread();
+  }
+  release_endpoints();
+  scrap_uhal();
+}
+
+void
+HSIMultiEndpointController::for_each_endpoint_parallel(const std::string& command,
+                                                       const std::function<void(Endpoint&)>& action)
+{
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::future<void>> results;
+  results.reserve(m_endpoints.size());
+  for (auto& endpoint : m_endpoints) {
+    results.push_back(std::async(std::launch::async, action, std::ref(*endpoint)));
+  }
+
+  std::vector<std::string> failed;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto& device_name = m_endpoints[i]->conf->get_device();
+    try {
+      results[i].get();
+    } catch (const ers::Issue& issue) {
+      ers::error(HSIEndpointCommandFailed(ERS_HERE, device_name, command, issue.message()));
+      failed.push_back(device_name);
+    } catch (const std::exception& excpt) {
+      ers::error(HSIEndpointCommandFailed(ERS_HERE, device_name, command, excpt.what()));
+      failed.push_back(device_name);
+    }
+  }
+
+  TLOG_DEBUG(0) << get_name() << ": " << command << " on " << m_endpoints.size() << " endpoints took "
+                << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time)
+                     .count()
+                << " ms";
+
+  if (!failed.empty()) {
+    std::ostringstream devices;
+    for (auto& device_name : failed) {
+      devices << (devices.tellp() > 0 ? ", " : "") << device_name;
+    }
+    throw HSIEndpointCommandFailed(ERS_HERE, devices.str(), command, "see the errors reported for each endpoint");
+  }
+}
+
+void
+HSIMultiEndpointController::configure_endpoint(Endpoint& endpoint)
+{
+  auto conf = endpoint.conf;
+  HSISettings settings{ conf->get_data_source(),
+                        conf->get_rising_edge_mask(),
+                        conf->get_falling_edge_mask(),
+                        conf->get_invert_edge_mask(),
+                        conf->get_trigger_rate() };
+  if (settings.trigger_rate <= 0) {
+    throw timinglibs::InvalidTriggerRateValue(ERS_HERE, settings.trigger_rate);
+  }
+
+  {
+    HSITransactionScheduler::Section section(*endpoint.device.scheduler, HSITransactionScheduler::Priority::kControl);
+    auto design = endpoint.design();
+
+    if (conf->get_control_hardware_io()) {
+      TLOG_DEBUG(0) << get_name() << ": " << conf->get_device() << " io reset";
+      hsi_io_reset(design, conf->get_soft_io_reset(), conf->get_clock_config(), conf->get_clock_source());
+    }
+
+    // the same sequences as the single endpoint controller: batched first, step by step if that does not read back
+    auto clock = read_hsi_clock_frequency(design);
+    hsi_configure_batched(*endpoint.device.hw, design, conf->get_endpoint_id(), conf->get_address(), settings, clock);
+    auto mismatches = hsi_configuration_mismatches(design, settings, clock);
+    if (!mismatches.empty()) {
+      ers::warning(HSIConfigurationMismatch(ERS_HERE, conf->get_device(), mismatches + ", configuring step by step"));
+      hsi_configure_stepwise(design, conf->get_endpoint_id(), conf->get_address(), settings);
+      mismatches = hsi_configuration_mismatches(design, settings, clock);
+      if (!mismatches.empty()) {
+        throw HSIConfigurationMismatch(ERS_HERE, conf->get_device(), mismatches);
+      }
+    }
+  }
+
+  update_endpoint_status(endpoint);
+}
+
+void
+HSIMultiEndpointController::start_endpoint(Endpoint& endpoint)
+{
+  if (!endpoint.device.readiness->wait_for(true, m_start_ready_timeout)) {
+    ers::warning(HSIDeviceNotReadyAtStart(ERS_HERE, endpoint.conf->get_device(), m_start_ready_timeout.count()));
+  }
+  HSITransactionScheduler::Section section(*endpoint.device.scheduler, HSITransactionScheduler::Priority::kControl);
+  auto& hsi_node = endpoint.design()->get_hsi_node();
+  if (!hsi_start_batched(hsi_node)) {
+    ers::warning(
+      HSIConfigurationMismatch(ERS_HERE, endpoint.conf->get_device(), "hsi block not enabled after batched start, starting again"));
+    hsi_node.start_hsi();
+  }
+}
+
+void
+HSIMultiEndpointController::stop_endpoint(Endpoint& endpoint)
+{
+  HSITransactionScheduler::Section section(*endpoint.device.scheduler, HSITransactionScheduler::Priority::kControl);
+  endpoint.design()->get_hsi_node().stop_hsi();
+}
+
+void
+HSIMultiEndpointController::update_endpoint_status(Endpoint& endpoint)
+{
+  auto conf = endpoint.conf;
+  timing::timingfirmwareinfo::TimingDeviceInfo device_info;
+  try {
+    HSITransactionScheduler::Section section(
+      *endpoint.device.scheduler, HSITransactionScheduler::Priority::kMonitoring, m_monitoring_max_defer);
+    endpoint.design()->get_info(device_info);
+  } catch (const std::exception& excpt) {
+    ++endpoint.failed_readbacks;
+    ers::warning(timinglibs::FailedToCollectOpMonInfo(ERS_HERE, conf->get_device(), excpt));
+    endpoint.device.readiness->update(false);
+    return;
+  }
+  ++endpoint.status_readbacks;
+
+  auto& ept_info = device_info.endpoint_info;
+  auto& hsi_info = device_info.hsi_info;
+
+  endpoint.endpoint_state = ept_info.state;
+  endpoint.buffer_enabled = hsi_info.buffer_enabled;
+  endpoint.buffer_error = hsi_info.buffer_error;
+  endpoint.buffer_warning = hsi_info.buffer_warning;
+  endpoint.configuration_matches =
+    hsi_info.re_mask == conf->get_rising_edge_mask() && hsi_info.fe_mask == conf->get_falling_edge_mask() &&
+    hsi_info.inv_mask == conf->get_invert_edge_mask() && hsi_info.source == conf->get_data_source();
+
+  bool ept_good = ept_info.state == 0x8 && ept_info.ready;
+  bool hsi_good = hsi_info.buffer_enabled && !hsi_info.buffer_error && !hsi_info.buffer_warning &&
+                  endpoint.configuration_matches.load();
+  endpoint.device.readiness->update(ept_good && hsi_good);
+}
+
+void
+HSIMultiEndpointController::monitor_endpoints(std::atomic<bool>& running_flag)
+{
+  apply_thread_settings(get_name() + "/gather-hsi-multi", m_thread_settings);
+
+  auto next_gather_time = std::chrono::steady_clock::now();
+  while (running_flag.load()) {
+    for (auto& endpoint : m_endpoints) {
+      update_endpoint_status(*endpoint);
+    }
+
+    next_gather_time += m_monitoring_period;
+
+    // check running_flag periodically
+    auto slice_period = std::chrono::milliseconds(10);
+    while (running_flag.load() && std::chrono::steady_clock::now() + slice_period < next_gather_time) {
+      std::this_thread::sleep_for(slice_period);
+    }
+    if (running_flag.load()) {
+      std::this_thread::sleep_until(next_gather_time);
+    }
+  }
+}
+
+void
+HSIMultiEndpointController::generate_opmon_data()
+{
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(m_endpoints_mutex);
+  for (auto& endpoint : m_endpoints) {
+    auto& readiness = *endpoint->device.readiness;
+
+    opmon::HSIEndpointStatus info;
+    info.set_ready(readiness.ready());
+    info.set_endpoint_state(endpoint->endpoint_state.load());
+    info.set_buffer_enabled(endpoint->buffer_enabled.load());
+    info.set_buffer_error(endpoint->buffer_error.load());
+    info.set_buffer_warning(endpoint->buffer_warning.load());
+    info.set_configuration_matches(endpoint->configuration_matches.load());
+    info.set_status_readbacks(endpoint->status_readbacks.load());
+    info.set_failed_readbacks(endpoint->failed_readbacks.load());
+    info.set_became_ready(readiness.became_ready());
+    info.set_became_not_ready(readiness.became_not_ready());
+    if (readiness.became_ready() + readiness.became_not_ready() > 0) {
+      info.set_ms_since_last_transition(
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - readiness.last_transition()).count());
+    }
+    publish(std::move(info), { { "endpoint", endpoint->conf->get_device() } });
+  }
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+DEFINE_DUNE_DAQ_MODULE(dunedaq::hsilibs::HSIMultiEndpointController)
+
+// Local Variables:
+// c-basic-offset: 2
+// End:
@@ -0,0 +1,128 @@
+/**
+ * @file HSIMultiEndpointController.hpp
+ *
+ * HSIMultiEndpointController is a DAQModule that configures, starts and
+ * monitors several HSI endpoints at once.
+ *
+ * This is part of the DUNE DAQ Software Suite, copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#ifndef HSILIBS_PLUGINS_HSIMULTIENDPOINTCONTROLLER_HPP_
+#define HSILIBS_PLUGINS_HSIMULTIENDPOINTCONTROLLER_HPP_
+
+#include "HSIDeviceRegistry.hpp"
+#include "HSIHardwareSequence.hpp"
+#include "HSIThreadTuning.hpp"
+#include "hsilibs/dal/HSIEndpointConf.hpp"
+#include "hsilibs/dal/HSIMultiEndpointController.hpp"
+#include "hsilibs/dal/HSIMultiEndpointControllerConf.hpp"
+
+#include "timinglibs/TimingHardwareInterface.hpp"
+
+#include "timing/HSIDesignInterface.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "appfwk/DAQModule.hpp"
+#include "ers/Issue.hpp"
+#include "logging/Logging.hpp"
+#include "utilities/WorkerThread.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief HSIMultiEndpointController drives a set of HSI endpoints from one module.
+ *
+ * Configure and start run the per-endpoint sequences concurrently, so the
+ * transition takes as long as the slowest board. One thread reads back the
+ * status of every endpoint and publishes readiness per endpoint.
+ */
+class HSIMultiEndpointController
+  : public dunedaq::appfwk::DAQModule
+  , dunedaq::timinglibs::TimingHardwareInterface
+{
+public:
+  /**
+   * @brief HSIMultiEndpointController Constructor
+   * @param name Instance name for this HSIMultiEndpointController instance
+   */
+  explicit HSIMultiEndpointController(const std::string& name);
+
+  HSIMultiEndpointController(const HSIMultiEndpointController&) = delete; ///< not copy-constructible
+  HSIMultiEndpointController& operator=(const HSIMultiEndpointController&) = delete; ///< not copy-assignable
+  HSIMultiEndpointController(HSIMultiEndpointController&&) = delete;                 ///< not move-constructible
+  HSIMultiEndpointController& operator=(HSIMultiEndpointController&&) = delete;      ///< not move-assignable
+
+  void init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg) override;
+
+protected:
+  void generate_opmon_data() override;
+
+private:
+  struct Endpoint
+  {
+    const dal::HSIEndpointConf* conf;
+    HSISharedDevice device;
+    int readiness_callback_id = -1;
+
+    std::atomic<uint32_t> endpoint_state{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<bool> buffer_enabled{ false };
+    std::atomic<bool> buffer_error{ false };
+    std::atomic<bool> buffer_warning{ false };
+    std::atomic<bool> configuration_matches{ false };
+    std::atomic<uint64_t> status_readbacks{ 0 }; // NOLINT(build/unsigned)
+    std::atomic<uint64_t> failed_readbacks{ 0 }; // NOLINT(build/unsigned)
+
+    const timing::HSIDesignInterface* design() const;
+  };
+
+  // Commands
+  void do_configure(const nlohmann::json& data);
+  void do_start(const nlohmann::json& data);
+  void do_stop(const nlohmann::json& data);
+  void do_scrap(const nlohmann::json& data);
+
+  // acquire every configured endpoint's device, then configure them concurrently
+  void configure_endpoints();
+  // unsubscribe from and drop the shared devices of all endpoints
+  void release_endpoints();
+
+  // per-endpoint sequences, run concurrently
+  void configure_endpoint(Endpoint& endpoint);
+  void start_endpoint(Endpoint& endpoint);
+  void stop_endpoint(Endpoint& endpoint);
+
+  // runs the action on every endpoint in parallel; reports every failure, then throws if there was one
+  void for_each_endpoint_parallel(const std::string& command, const std::function<void(Endpoint&)>& action);
+
+  void update_endpoint_status(Endpoint& endpoint);
+  void monitor_endpoints(std::atomic<bool>& running_flag);
+
+  const dal::HSIMultiEndpointControllerConf* m_configuration;
+  std::vector<std::unique_ptr<Endpoint>> m_endpoints;
+  std::mutex m_endpoints_mutex; // the list only changes in conf and scrap, but opmon reads it from its own thread
+
+  dunedaq::utilities::WorkerThread m_thread;
+  std::chrono::milliseconds m_monitoring_period;
+  std::chrono::milliseconds m_monitoring_max_defer;
+  std::chrono::milliseconds m_start_ready_timeout;
+  HSIThreadSettings m_thread_settings;
+};
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_PLUGINS_HSIMULTIENDPOINTCONTROLLER_HPP_
+
+// Local Variables:
+// c-basic-offset: 2
+// End:
@@ -8,6 +8,7 @@
  */
 
 #include "HSIReadout.hpp"
+#include "hsilibs/opmon/readout_info.pb.h"
 
 #include "timing/TimingIssues.hpp"
 #include "timing/HSIDesignInterface.hpp"
@@ -42,6 +43,7 @@ HSIReadout::HSIReadout(const std::string& name)
   register_command("start", &HSIReadout::do_start);
   register_command("stop", &HSIReadout::do_stop);
   register_command("scrap", &HSIReadout::do_scrap);
+  register_command("dump_trace", &HSIReadout::do_dump_trace);
 }
 
 void
@@ -69,6 +71,9 @@ HSIReadout::do_configure(const nlohmann::json& /*data*/)
 
   m_readout_period = m_params->get_readout_period();
 
+  auto tuning_params = m_params->cast<dal::HSIReadoutTuningConf>();
+  m_thread_settings = HSIThreadSettings::from_conf(tuning_params != nullptr ? tuning_params->get_thread_conf() : nullptr);
+
   configure_uhal(m_params->get_uhal_log_level(), m_params->get_connections_file()); // configure hw ipbus connection
 
   if (m_params->get_hsi_device_name().empty())
@@ -78,7 +83,12 @@ HSIReadout::do_configure(const nlohmann::json& /*data*/)
   m_hsi_device_name = m_params->get_hsi_device_name();
 
   try {
-    m_hsi_device = std::make_unique<uhal::HwInterface>(m_connection_manager->getDevice(m_hsi_device_name));
+    auto shared_device = HSIDeviceRegistry::get().acquire(m_params->get_connections_file(), m_hsi_device_name, [this]() {
+      return std::make_shared<uhal::HwInterface>(m_connection_manager->getDevice(m_hsi_device_name));
+    });
+    m_hsi_device = shared_device.hw;
+    m_hsi_scheduler = shared_device.scheduler;
+    m_hsi_readiness = shared_device.readiness;
   } catch (const uhal::exception::ConnectionUIDDoesNotExist& exception) {
     std::stringstream message;
     message << "UHAL device name not " << m_hsi_device_name << " in connections file";
@@ -112,15 +122,27 @@ void
 HSIReadout::do_scrap(const nlohmann::json& /*data*/)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_scrap() method";
+  m_hsi_device.reset();
+  m_hsi_scheduler.reset();
+  m_hsi_readiness.reset();
   scrap_uhal();
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Exiting do_scrap() method";
 }
 
+void
+HSIReadout::do_dump_trace(const nlohmann::json& data)
+{
+  dump_trace_rings(data.value("directory", m_thread_settings.trace_dump_directory),
+                   data.value("reason", std::string("dump_trace command")));
+}
+
 void
 HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
 {
   TLOG_DEBUG(TLVL_ENTER_EXIT_METHODS) << get_name() << ": Entering do_hsievent_work() method";
 
+  apply_thread_settings(get_name() + "/read-hsi-events", m_thread_settings);
+
   m_readout_counter = 0;
   m_sent_counter = 0;
   m_failed_to_send_counter = 0;
@@ -132,33 +154,62 @@ HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
   auto hsi_node = hsi_design->get_hsi_node();
   auto ept_node = hsi_design->get_endpoint_node_plain(0);
 
-  while (running_flag.load()) {
-        
-    // endpoint should be ready if already running
-    auto hsi_endpoint_ready = ept_node->endpoint_ready();
-    if (!hsi_endpoint_ready)
-    {
-      auto hsi_endpoint_state = ept_node->read_endpoint_state();
-      ers::error(timing::EndpointNotReady(ERS_HERE, "HSI", hsi_endpoint_state));
+  m_poll_timer.reset(std::chrono::microseconds(m_readout_period));
+
+  // the rings are dumped on the first error of a run only, the records around later errors are overwritten soon anyway
+  bool trace_dumped = false;
+  auto trace_error = [&](HSITraceError error, uint64_t timestamp, uint32_t header, uint32_t aux) { // NOLINT(build/unsigned)
+    hsi_trace(HSITraceStage::kError, static_cast<uint16_t>(error), timestamp, header, 0, aux); // NOLINT(build/unsigned)
+    if (!trace_dumped && t_hsi_trace_ring != nullptr) {
+      trace_dumped = true;
+      dump_trace_rings(m_thread_settings.trace_dump_directory, "first readout error of the run");
     }
-    
-    auto hsi_emulation_mode = hsi_node.read_signal_source_mode();
+  };
+
+  while (running_flag.load()) {
 
+    auto iteration_start = m_poll_timer.begin_iteration();
+    bool hsi_emulation_mode;
     uhal::ValVector<uint32_t> hsi_words;
     try
     {
+      // one readout section per poll: other users of the device wait until the buffer has been read
+      HSITransactionScheduler::Section section(*m_hsi_scheduler, HSITransactionScheduler::Priority::kReadout);
+
+      // endpoint should be ready if already running; a readiness report from a controller of the same
+      // device that is at most one of its monitoring cycles old saves the register read, anything else
+      // (no controller, a missed readback, not ready) goes to the hardware
+      bool hsi_endpoint_ready = m_hsi_readiness->fresh() && m_hsi_readiness->ready();
+      if (!hsi_endpoint_ready) {
+        hsi_endpoint_ready = ept_node->endpoint_ready();
+      }
+      if (!hsi_endpoint_ready)
+      {
+        auto hsi_endpoint_state = ept_node->read_endpoint_state();
+        ers::error(timing::EndpointNotReady(ERS_HERE, "HSI", hsi_endpoint_state));
+      }
+
+      hsi_emulation_mode = hsi_node.read_signal_source_mode();
+
       uint16_t n_words_in_buffer; // NOLINT(build/unsigned)
 
       hsi_words = hsi_node.read_data_buffer(n_words_in_buffer, false, true);
       update_buffer_counts(n_words_in_buffer);
+      hsi_trace(HSITraceStage::kPoll, hsi_emulation_mode, 0, 0, 0, n_words_in_buffer);
       TLOG_DEBUG(5) << get_name() << ": Number of words in HSI buffer: " << n_words_in_buffer;
     }
     catch (const uhal::exception::UdpTimeout& excpt)
     {
       ers::error(HSIReadoutNetworkIssue(ERS_HERE, excpt));
-      std::this_thread::sleep_for(std::chrono::microseconds(m_readout_period));
+      trace_error(HSITraceError::kUdpTimeout, 0, 0, 0);
+      m_poll_timer.record_read(HSIPollTimer::elapsed_ns(iteration_start, HSIPollTimer::clock_t::now()));
+      m_poll_timer.end_iteration(iteration_start);
+      wait_for_next_poll(running_flag);
       continue;
     }
+    auto read_end = HSIPollTimer::clock_t::now();
+    m_poll_timer.record_read(HSIPollTimer::elapsed_ns(iteration_start, read_end));
+    uint64_t send_ns = 0; // NOLINT(build/unsigned)
     
     constexpr size_t n_words_per_hsi_buffer_event = timing::HSINode::hsi_buffer_event_words_number;
     // one or more complete events
@@ -190,14 +241,18 @@ HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
         // bits 15-0 contain the sequence counter
         uint32_t counter = header & 0x0000ffff; // NOLINT(build/unsigned)
 
+        hsi_trace(HSITraceStage::kDecode, 0, ts, header, trigger, data);
+
         if ((header >> 16) != 0xaa00) {
           ers::error(InvalidHSIEventHeader(ERS_HERE,header));
+          trace_error(HSITraceError::kInvalidHeader, ts, header, data);
           continue;
         }
 
         if (!ts)
         {
           ers::warning(InvalidHSIEventTimestamp(ERS_HERE,ts));
+          trace_error(HSITraceError::kInvalidTimestamp, ts, header, data);
           continue;
         }
 
@@ -223,17 +278,12 @@ HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
           
         m_last_readout_timestamp.store(ts);
 
+        auto send_start = HSIPollTimer::clock_t::now();
         send_hsi_event(event);
+        send_ns += HSIPollTimer::elapsed_ns(send_start, HSIPollTimer::clock_t::now());
 
         // Send raw HSI data to a DLH 
-        std::array<uint32_t, 7> hsi_struct;
-        hsi_struct[0] = (0x1 << 6) | 0x1; // DAQHeader, frame version: 1, det id: 1
-        hsi_struct[1] = ts_low;
-        hsi_struct[2] = ts_high;
-        hsi_struct[3] = data;
-        hsi_struct[4] = 0x0;
-        hsi_struct[5] = trigger;
-        hsi_struct[6] = counter;
+        auto hsi_struct = make_raw_hsi_data(ts, data, trigger, counter);
 
         TLOG_DEBUG(3) << get_name() << ": Formed HSI_FRAME_STRUCT "
               << std::hex 
@@ -246,8 +296,13 @@ HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
               << ", 0x" << hsi_struct[6]
               << "\n";
 
+        send_start = HSIPollTimer::clock_t::now();
         send_raw_hsi_data(hsi_struct, m_raw_hsi_data_sender.get());
+        send_ns += HSIPollTimer::elapsed_ns(send_start, HSIPollTimer::clock_t::now());
       }
+      auto events_ns = HSIPollTimer::elapsed_ns(read_end, HSIPollTimer::clock_t::now());
+      m_poll_timer.record_decode(events_ns > send_ns ? events_ns - send_ns : 0);
+      m_poll_timer.record_send(send_ns);
     }
     // empty buffer is ok
     else if (hsi_words.size() == 0)
@@ -258,16 +313,59 @@ HSIReadout::do_hsi_work(std::atomic<bool>& running_flag)
     else
     {
       ers::error(InvalidNumberReadoutHSIWords(ERS_HERE, hsi_words.size()));
+      trace_error(HSITraceError::kInvalidWordCount, 0, 0, hsi_words.size());
     }
-    std::this_thread::sleep_for(std::chrono::microseconds(m_readout_period));
+    m_poll_timer.end_iteration(iteration_start);
+    wait_for_next_poll(running_flag);
   }
   std::ostringstream oss_summ;
   oss_summ << ": Exiting the read_hsievents() method, read out " << m_readout_counter.load()
            << " HSIEvent messages and successfully sent " << m_sent_counter.load() << " copies. ";
   ers::info(hsilibs::ProgressUpdate(ERS_HERE, get_name(), oss_summ.str()));
+  ers::info(hsilibs::ProgressUpdate(ERS_HERE, get_name(), "polling loop timing; " + m_poll_timer.summary()));
   TLOG_DEBUG(2) << get_name() << ": Exiting do_work() method";
 }
 
+void
+HSIReadout::generate_opmon_data()
+{
+  constexpr double ns_per_us = 1000.;
+  auto& period = m_poll_timer.period_ns();
+  auto& read = m_poll_timer.read_ns();
+  auto& decode = m_poll_timer.decode_ns();
+  auto& send = m_poll_timer.send_ns();
+
+  opmon::HSIReadoutPollingInfo info;
+  info.set_polls(read.count());
+  info.set_scheduled_period_us(m_poll_timer.scheduled_period_ns() / ns_per_us);
+  info.set_mean_period_us(period.mean() / ns_per_us);
+  info.set_p99_period_us(period.quantile(0.99) / ns_per_us);
+  info.set_max_period_us(period.max() / ns_per_us);
+  info.set_p99_overshoot_us(m_poll_timer.overshoot_ns().quantile(0.99) / ns_per_us);
+  info.set_mean_read_us(read.mean() / ns_per_us);
+  info.set_p99_read_us(read.quantile(0.99) / ns_per_us);
+  info.set_max_read_us(read.max() / ns_per_us);
+  info.set_p99_decode_us(decode.quantile(0.99) / ns_per_us);
+  info.set_max_decode_us(decode.max() / ns_per_us);
+  info.set_p99_send_us(send.quantile(0.99) / ns_per_us);
+  info.set_max_send_us(send.max() / ns_per_us);
+  info.set_duty_cycle(m_poll_timer.duty_cycle());
+  publish(std::move(info));
+}
+
+void
+HSIReadout::wait_for_next_poll(const std::atomic<bool>& running_flag) const
+{
+  if (!m_thread_settings.busy_poll) {
+    std::this_thread::sleep_for(std::chrono::microseconds(m_readout_period));
+    return;
+  }
+  auto next_poll_time = std::chrono::steady_clock::now() + std::chrono::microseconds(m_readout_period);
+  while (std::chrono::steady_clock::now() < next_poll_time && running_flag.load(std::memory_order_relaxed)) {
+    cpu_relax();
+  }
+}
+
 void
 HSIReadout::update_buffer_counts(uint16_t new_count) // NOLINT(build/unsigned)
 {
@@ -7,11 +7,16 @@
 #ifndef HSILIBS_PLUGINS_HSIREADOUT_HPP_
 #define HSILIBS_PLUGINS_HSIREADOUT_HPP_
 
+#include "HSIDeviceRegistry.hpp"
+#include "HSIPollTimer.hpp"
+#include "HSIThreadTuning.hpp"
+#include "HSITraceRing.hpp"
 #include "hsilibs/HSIEventSender.hpp"
 
 #include "timinglibs/TimingHardwareInterface.hpp"
 #include "appmodel/HSIReadout.hpp"
 #include "appmodel/HSIReadoutConf.hpp"
+#include "hsilibs/dal/HSIReadoutTuningConf.hpp"
 
 #include "appfwk/DAQModule.hpp"
 #include "dfmessages/HSIEvent.hpp"
@@ -56,6 +61,9 @@ public:
   void init(std::shared_ptr<appfwk::ModuleConfiguration> mcfg) override;
   // void get_info(opmonlib::InfoCollector& ci, int level) override;
 
+protected:
+  void generate_opmon_data() override;
+
 private:
   // Commands
   const appmodel::HSIReadoutConf* m_params;
@@ -63,6 +71,7 @@ private:
   void do_start(const nlohmann::json& data) override;
   void do_stop(const nlohmann::json& data) override;
   void do_scrap(const nlohmann::json& data) override;
+  void do_dump_trace(const nlohmann::json& data);
 
   std::shared_ptr<raw_sender_ct> m_raw_hsi_data_sender;
   
@@ -73,7 +82,15 @@ private:
   std::string m_hsi_device_name;
   uint m_readout_period; // NOLINT(build/unsigned)
 
-  std::unique_ptr<uhal::HwInterface> m_hsi_device;
+  // shared with any other module of this process that talks to the same device
+  std::shared_ptr<uhal::HwInterface> m_hsi_device;
+  std::shared_ptr<HSITransactionScheduler> m_hsi_scheduler;
+  std::shared_ptr<HSIReadinessTracker> m_hsi_readiness;
+
+  HSIThreadSettings m_thread_settings;
+  HSIPollTimer m_poll_timer; // filled by the readout thread, read by opmon
+  // sleep, or spin when busy polling, for one readout period
+  void wait_for_next_poll(const std::atomic<bool>& running_flag) const;
   std::atomic<daqdataformats::run_number_t> m_run_number;
 
   std::atomic<uint64_t> m_readout_counter;        // NOLINT(build/unsigned)
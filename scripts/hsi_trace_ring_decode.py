@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Decode HSI trace ring dumps (.hsiring files) written by HSIReadout and FakeHSIEventGeneratorModule.
+
+The record layout follows src/HSITraceRing.hpp.
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"HSIRNG01"
+HEADER = struct.Struct("<8sIIQQ64s64s")
+RECORD = struct.Struct("<QQIIHHI")
+
+STAGES = {
+    1: "poll",
+    2: "decode",
+    3: "send_event",
+    4: "send_raw",
+    5: "generate",
+    15: "error",
+}
+
+ERRORS = {
+    1: "udp_timeout",
+    2: "invalid_header",
+    3: "invalid_timestamp",
+    4: "invalid_word_count",
+}
+
+
+def read_dump(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        raise ValueError(f"{path}: too short for a trace ring dump")
+    magic, version, record_size, count, overwritten, name, reason = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError(f"{path}: not a trace ring dump (magic {magic!r})")
+    if version != 1 or record_size != RECORD.size:
+        raise ValueError(f"{path}: unsupported dump version {version} / record size {record_size}")
+    available = (len(data) - HEADER.size) // RECORD.size
+    if available < count:
+        print(f"{path}: truncated, {available} of {count} records present", file=sys.stderr)
+        count = available
+    info = {
+        "thread": name.split(b"\0", 1)[0].decode(errors="replace"),
+        "reason": reason.split(b"\0", 1)[0].decode(errors="replace"),
+        "records": count,
+        "overwritten": overwritten,
+    }
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(count)]
+    return info, records
+
+
+def header_fields(stage, status, header, aux):
+    """Device id and sequence counter of a record, None where the stage does not record them."""
+    if stage == 2 or (stage == 15 and status in (2, 3)):
+        # HSI buffer header: bits 31-16 device id, bits 15-0 sequence counter
+        return header >> 16, header & 0xffff
+    if stage in (3, 5):
+        # the device id as sent in the HSIEvent, the sequence counter in aux
+        return header, aux
+    return None, None
+
+
+def describe(stage, status):
+    stage_name = STAGES.get(stage, f"stage{stage}")
+    if stage == 15:
+        return stage_name, ERRORS.get(status, str(status))
+    return stage_name, str(status)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("dumps", nargs="+", help="trace ring dump files")
+    parser.add_argument("--csv", action="store_true", help="write one CSV row per record instead of a table")
+    parser.add_argument("--stage", action="append", choices=sorted(STAGES.values()), help="only show these stages")
+    args = parser.parse_args()
+
+    writer = csv.writer(sys.stdout) if args.csv else None
+    if writer:
+        writer.writerow(["thread", "time_ns", "dt_us", "stage", "status", "timestamp", "header", "device_id",
+                         "sequence", "signal_map", "aux"])
+
+    for path in args.dumps:
+        try:
+            info, records = read_dump(path)
+        except (OSError, ValueError) as error:
+            print(error, file=sys.stderr)
+            return 1
+        if not writer:
+            print(f"# {path}: thread {info['thread']}, {info['records']} records "
+                  f"({info['overwritten']} older overwritten), reason: {info['reason']}")
+        first_ns = records[0][0] if records else 0
+        previous_ns = first_ns
+        for time_ns, timestamp, header, signal_map, stage, status, aux in records:
+            stage_name, status_text = describe(stage, status)
+            if args.stage and stage_name not in args.stage:
+                continue
+            dt_us = (time_ns - previous_ns) / 1000.
+            previous_ns = time_ns
+            device_id, sequence = header_fields(stage, status, header, aux)
+            if writer:
+                writer.writerow([info["thread"], time_ns, f"{dt_us:.3f}", stage_name, status_text, timestamp,
+                                 f"0x{header:08x}", "" if device_id is None else device_id,
+                                 "" if sequence is None else sequence, f"0x{signal_map:08x}", aux])
+            else:
+                fields = f"  dev {device_id} seq {sequence}" if device_id is not None else ""
+                print(f"{(time_ns - first_ns) / 1000.:14.3f} us  +{dt_us:10.3f}  {stage_name:<10} {status_text:<18} "
+                      f"ts {timestamp:>20}  hdr 0x{header:08x}  map 0x{signal_map:08x}  aux {aux}{fields}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
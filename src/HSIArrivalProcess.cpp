@@ -0,0 +1,97 @@
+/**
+ * @file HSIArrivalProcess.cpp Inter-arrival time models for the fake HSI
+ * generator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSIArrivalProcess.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+HSIArrivalProcess::Model
+HSIArrivalProcess::model_from_string(const std::string& model)
+{
+  if (model == "exponential") {
+    return Model::kExponential;
+  }
+  if (model == "hawkes") {
+    return Model::kHawkes;
+  }
+  return Model::kPeriodic;
+}
+
+const char*
+HSIArrivalProcess::model_name(Model model)
+{
+  switch (model) {
+    case Model::kExponential:
+      return "exponential";
+    case Model::kHawkes:
+      return "hawkes";
+    default:
+      return "periodic";
+  }
+}
+
+void
+HSIArrivalProcess::configure(Model model, double branching_ratio, double decay_time_s, std::size_t batch_size)
+{
+  m_model = model;
+  // a branching ratio of 1 or more makes the process explode
+  m_branching_ratio = std::clamp(branching_ratio, 0., 0.99);
+  m_decay_time_s = decay_time_s > 0 ? decay_time_s : 1.e-3;
+  m_batch_size = std::max<std::size_t>(batch_size, 1);
+  m_batch.reserve(m_batch_size);
+  reset();
+}
+
+void
+HSIArrivalProcess::reset()
+{
+  m_batch.clear();
+  m_position = 0;
+  m_excitation = 0.;
+  m_since_last = 0.;
+}
+
+void
+HSIArrivalProcess::refill()
+{
+  m_batch.clear();
+  m_position = 0;
+  for (std::size_t i = 0; i < m_batch_size; ++i) {
+    m_batch.push_back(m_exponential(m_generator));
+  }
+}
+
+double
+HSIArrivalProcess::next_hawkes_interval(double rate)
+{
+  // Ogata thinning: between events the intensity only decays, so its
+  // current value bounds it until the next candidate
+  const double beta = 1. / m_decay_time_s;
+  const double mu = rate * (1. - m_branching_ratio);
+  const double jump = m_branching_ratio * beta;
+  while (true) {
+    double bound = mu + m_excitation;
+    double wait = m_exponential(m_generator) / bound;
+    m_since_last += wait;
+    m_excitation *= std::exp(-beta * wait);
+    if (m_uniform(m_generator) * bound <= mu + m_excitation) {
+      double interval = m_since_last;
+      m_since_last = 0.;
+      m_excitation += jump;
+      return interval;
+    }
+  }
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,97 @@
+/**
+ * @file HSIArrivalProcess.hpp Inter-arrival time models for the fake HSI
+ * generator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIARRIVALPROCESS_HPP_
+#define HSILIBS_SRC_HSIARRIVALPROCESS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Source of inter-arrival times [s] for a given mean rate.
+ *
+ * periodic: exactly 1 / rate. exponential: a Poisson process. hawkes: a
+ * self-exciting process with an exponential kernel, where each event raises
+ * the intensity by branching_ratio / decay_time and that excess decays with
+ * decay_time. The background intensity is rate * (1 - branching_ratio), so
+ * the long-run mean rate is still rate, but events come in clusters.
+ *
+ * Exponential intervals are drawn at unit rate in batches of batch_size
+ * into a buffer, handed out one by one and scaled by the rate when they are
+ * consumed. Hawkes intervals depend on the rate and on the process state, so
+ * they are generated one at a time: a rate change then affects the very next
+ * interval and the state only ever reflects intervals actually handed out.
+ */
+class HSIArrivalProcess
+{
+public:
+  enum class Model
+  {
+    kPeriodic,
+    kExponential,
+    kHawkes
+  };
+
+  static Model model_from_string(const std::string& model);
+  static const char* model_name(Model model);
+
+  void configure(Model model, double branching_ratio, double decay_time_s, std::size_t batch_size);
+  void reset();
+  void seed(uint64_t seed) { m_generator.seed(seed); } // NOLINT(build/unsigned)
+
+  Model model() const { return m_model; }
+  bool is_periodic() const { return m_model == Model::kPeriodic; }
+
+  /**
+   * @brief Time to the next event at the given mean rate (> 0)
+   */
+  double next_interval(double rate)
+  {
+    if (m_model == Model::kPeriodic) {
+      return 1. / rate;
+    }
+    if (m_model == Model::kHawkes) {
+      return next_hawkes_interval(rate);
+    }
+    if (m_position == m_batch.size()) {
+      refill();
+    }
+    return m_batch[m_position++] / rate;
+  }
+
+private:
+  void refill();
+  double next_hawkes_interval(double rate);
+
+  Model m_model = Model::kPeriodic;
+  double m_branching_ratio = 0.;
+  double m_decay_time_s = 1.e-3;
+
+  std::vector<double> m_batch;
+  std::size_t m_batch_size = 4096;
+  std::size_t m_position = 0;
+
+  // Hawkes state carried between intervals: excess intensity and time since the last event
+  double m_excitation = 0.;
+  double m_since_last = 0.;
+
+  std::mt19937_64 m_generator;
+  std::exponential_distribution<double> m_exponential{ 1. };
+  std::uniform_real_distribution<double> m_uniform{ 0., 1. };
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIARRIVALPROCESS_HPP_
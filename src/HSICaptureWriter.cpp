@@ -0,0 +1,531 @@
+/**
+ * @file HSICaptureWriter.cpp Asynchronous, rotating raw HSI frame capture
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSICaptureWriter.hpp"
+
+#include "hsilibs/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#ifdef HSILIBS_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace hsilibs {
+
+struct HSICaptureWriter::File
+{
+  int fd = -1;
+  std::string path;
+  uint64_t logical_size = 0; // NOLINT(build/unsigned)
+
+  // the last writer reference going away trims the padding of the last block
+  ~File()
+  {
+    if (fd >= 0) {
+      if (::ftruncate(fd, logical_size) != 0) {
+        ers::warning(HSICaptureIssue(ERS_HERE, path, std::strerror(errno)));
+      }
+      ::close(fd);
+    }
+  }
+};
+
+/**
+ * @brief Writes submitted blocks and reports their completion.
+ */
+class HSICaptureWriter::Backend
+{
+public:
+  explicit Backend(HSICaptureWriter& writer)
+    : m_writer(writer)
+  {}
+  virtual ~Backend() = default;
+  virtual void submit(std::size_t index) = 0;
+  virtual const char* name() const = 0;
+
+protected:
+  Block& block(std::size_t index) { return m_writer.m_blocks[index]; }
+  std::size_t block_size() const { return m_writer.m_config.buffer_size_bytes; }
+  void complete(std::size_t index, bool ok, std::size_t bytes) { m_writer.release_block(index, ok, bytes); }
+
+private:
+  HSICaptureWriter& m_writer;
+};
+
+namespace {
+
+class ThreadPoolBackend : public HSICaptureWriter::Backend
+{
+public:
+  ThreadPoolBackend(HSICaptureWriter& writer, std::size_t n_threads)
+    : Backend(writer)
+  {
+    for (std::size_t i = 0; i < std::max<std::size_t>(n_threads, 1); ++i) {
+      m_threads.emplace_back(&ThreadPoolBackend::run, this);
+      pthread_setname_np(m_threads.back().native_handle(), ("hsi-capture-" + std::to_string(i)).c_str());
+    }
+  }
+
+  ~ThreadPoolBackend() override
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  void submit(std::size_t index) override
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_mutex);
+      m_queue.push_back(index);
+    }
+    m_cv.notify_one();
+  }
+
+  const char* name() const override { return "thread-pool"; }
+
+private:
+  void run()
+  {
+    while (true) {
+      std::size_t index;
+      {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        m_cv.wait(lk, [&] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+          return;
+        }
+        index = m_queue.front();
+        m_queue.pop_front();
+      }
+
+      auto& b = block(index);
+      std::size_t done = 0;
+      bool ok = true;
+      while (done < block_size()) {
+        auto n = ::pwrite(b.file->fd, b.data + done, block_size() - done, b.offset + done);
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n <= 0) {
+          ok = false;
+          break;
+        }
+        done += n;
+      }
+      complete(index, ok, done);
+    }
+  }
+
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::size_t> m_queue;
+  bool m_stop = false;
+};
+
+#ifdef HSILIBS_HAVE_LIBURING
+class IoUringBackend : public HSICaptureWriter::Backend
+{
+public:
+  IoUringBackend(HSICaptureWriter& writer, unsigned depth)
+    : Backend(writer)
+  {
+    auto ret = io_uring_queue_init(depth + 1, &m_ring, 0);
+    if (ret < 0) {
+      throw std::runtime_error(std::string("io_uring_queue_init: ") + std::strerror(-ret));
+    }
+    m_reaper = std::thread(&IoUringBackend::reap, this);
+    pthread_setname_np(m_reaper.native_handle(), "hsi-cap-uring");
+  }
+
+  ~IoUringBackend() override
+  {
+    {
+      // a NOP with null user data tells the reaper to exit
+      std::lock_guard<std::mutex> lk(m_submit_mutex);
+      auto sqe = io_uring_get_sqe(&m_ring);
+      io_uring_prep_nop(sqe);
+      io_uring_sqe_set_data(sqe, nullptr);
+      io_uring_submit(&m_ring);
+    }
+    m_reaper.join();
+    io_uring_queue_exit(&m_ring);
+  }
+
+  void submit(std::size_t index) override
+  {
+    auto& b = block(index);
+    std::lock_guard<std::mutex> lk(m_submit_mutex);
+    auto sqe = io_uring_get_sqe(&m_ring);
+    io_uring_prep_write(sqe, b.file->fd, b.data, block_size(), b.offset);
+    io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(index + 1)); // NOLINT
+    io_uring_submit(&m_ring);
+  }
+
+  const char* name() const override { return "io_uring"; }
+
+private:
+  void reap()
+  {
+    while (true) {
+      struct io_uring_cqe* cqe = nullptr;
+      auto ret = io_uring_wait_cqe(&m_ring, &cqe);
+      if (ret == -EINTR) {
+        continue;
+      }
+      if (ret < 0) {
+        return;
+      }
+      auto tag = reinterpret_cast<std::size_t>(io_uring_cqe_get_data(cqe)); // NOLINT
+      auto res = cqe->res;
+      io_uring_cqe_seen(&m_ring, cqe);
+      if (tag == 0) {
+        return;
+      }
+      complete(tag - 1, res == static_cast<int>(block_size()), res > 0 ? res : 0);
+    }
+  }
+
+  struct io_uring m_ring;
+  std::mutex m_submit_mutex;
+  std::thread m_reaper;
+};
+#endif
+
+} // namespace
+
+HSICaptureWriter::HSICaptureWriter(const Config& config)
+  : m_config(config)
+{
+  // blocks are whole pages so the backend can use O_DIRECT
+  constexpr std::size_t page = HSICaptureFileHeader::s_header_block_size;
+  m_config.buffer_size_bytes = std::max(page, (m_config.buffer_size_bytes + page - 1) / page * page);
+  m_config.num_buffers = std::max<std::size_t>(m_config.num_buffers, 2);
+  m_frames_per_block = m_config.buffer_size_bytes / sizeof(HSI_FRAME_STRUCT);
+
+  void* memory = nullptr;
+  if (posix_memalign(&memory, page, m_config.buffer_size_bytes * m_config.num_buffers) != 0) {
+    throw std::bad_alloc();
+  }
+  m_memory = static_cast<char*>(memory);
+  std::memset(m_memory, 0, m_config.buffer_size_bytes * m_config.num_buffers);
+
+  m_blocks.resize(m_config.num_buffers);
+  for (std::size_t i = 0; i < m_config.num_buffers; ++i) {
+    m_blocks[i].data = m_memory + i * m_config.buffer_size_bytes;
+    m_free_blocks.push_back(i);
+  }
+
+#ifdef HSILIBS_HAVE_LIBURING
+  if (m_config.use_io_uring) {
+    try {
+      m_backend = std::make_unique<IoUringBackend>(*this, m_config.num_buffers);
+    } catch (const std::exception& excpt) {
+      TLOG() << "io_uring not available for HSI capture (" << excpt.what() << "), using thread pool";
+    }
+  }
+#endif
+  if (!m_backend) {
+    m_backend = std::make_unique<ThreadPoolBackend>(*this, m_config.io_threads);
+  }
+}
+
+HSICaptureWriter::~HSICaptureWriter()
+{
+  close();
+  m_backend.reset();
+  std::free(m_memory);
+}
+
+const char*
+HSICaptureWriter::backend_name() const
+{
+  return m_backend->name();
+}
+
+bool
+HSICaptureWriter::open(uint64_t run_number, uint64_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  close();
+
+  std::lock_guard<std::mutex> lk(m_append_mutex);
+  m_run_number = run_number;
+  m_clock_frequency_hz = clock_frequency_hz;
+  m_file_index = 0;
+  m_file_paths.clear();
+  m_frames_written = 0;
+  m_bytes_written = 0;
+  m_frames_dropped = 0;
+  m_files_opened = 0;
+  m_write_errors = 0;
+  m_max_write_latency_us = 0;
+  if (!open_next_file()) {
+    return false;
+  }
+  m_open.store(true, std::memory_order_release);
+  TLOG() << "Started raw HSI capture for run " << run_number << " in " << m_config.directory << " ("
+         << backend_name() << " backend, " << m_config.num_buffers << " x " << m_config.buffer_size_bytes
+         << " byte buffers)";
+  return true;
+}
+
+bool
+HSICaptureWriter::open_next_file()
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "_run%06lu_%04u.bin", static_cast<unsigned long>(m_run_number), m_file_index); // NOLINT
+  auto file = std::make_shared<File>();
+  file->path = m_config.directory + "/" + m_config.file_prefix + name;
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  if (m_config.direct_io) {
+    file->fd = ::open(file->path.c_str(), flags | O_DIRECT, 0644);
+  }
+  if (file->fd < 0) {
+    file->fd = ::open(file->path.c_str(), flags, 0644);
+  }
+  if (file->fd < 0) {
+    ers::error(HSICaptureIssue(ERS_HERE, file->path, std::strerror(errno)));
+    ++m_write_errors;
+    return false;
+  }
+
+  void* header_block = nullptr;
+  if (posix_memalign(&header_block, HSICaptureFileHeader::s_header_block_size,
+                     HSICaptureFileHeader::s_header_block_size) != 0) {
+    throw std::bad_alloc();
+  }
+  std::memset(header_block, 0, HSICaptureFileHeader::s_header_block_size);
+  HSICaptureFileHeader header;
+  header.frames_per_block = m_frames_per_block;
+  header.block_size = m_config.buffer_size_bytes;
+  header.run_number = m_run_number;
+  header.clock_frequency_hz = m_clock_frequency_hz;
+  header.file_index = m_file_index;
+  header.creation_time_ns =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  std::memcpy(header_block, &header, sizeof(header));
+  auto written = ::pwrite(file->fd, header_block, HSICaptureFileHeader::s_header_block_size, 0);
+  std::free(header_block);
+  if (written != static_cast<ssize_t>(HSICaptureFileHeader::s_header_block_size)) {
+    ers::error(HSICaptureIssue(ERS_HERE, file->path, "failed to write file header"));
+    ++m_write_errors;
+    return false;
+  }
+  file->logical_size = HSICaptureFileHeader::s_header_block_size;
+
+  m_file = file;
+  m_file_offset = HSICaptureFileHeader::s_header_block_size;
+  m_file_paths.push_back(file->path);
+  ++m_file_index;
+  ++m_files_opened;
+  TLOG_DEBUG(2) << "Opened HSI capture file " << file->path;
+
+  // keep a bounded set of files: drop the oldest once the limit is exceeded
+  if (m_config.max_files > 0 && m_file_paths.size() > m_config.max_files) {
+    ::unlink(m_file_paths.front().c_str());
+    m_file_paths.erase(m_file_paths.begin());
+  }
+  return true;
+}
+
+bool
+HSICaptureWriter::acquire_block()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_free_mutex);
+    if (m_free_blocks.empty()) {
+      return false;
+    }
+    m_current = m_free_blocks.back();
+    m_free_blocks.pop_back();
+  }
+
+  if (m_file_offset + m_config.buffer_size_bytes > m_config.max_file_size_bytes &&
+      m_file_offset > HSICaptureFileHeader::s_header_block_size) {
+    if (!open_next_file()) {
+      release_block(m_current, true, 0);
+      m_current = SIZE_MAX;
+      return false;
+    }
+  }
+
+  auto& b = m_blocks[m_current];
+  b.frames = 0;
+  b.file = m_file;
+  b.offset = m_file_offset;
+  m_file_offset += m_config.buffer_size_bytes;
+  return true;
+}
+
+void
+HSICaptureWriter::append(const HSI_FRAME_STRUCT& frame)
+{
+  std::lock_guard<std::mutex> lk(m_append_mutex);
+  if (!m_open.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (m_current == SIZE_MAX && !acquire_block()) {
+    m_frames_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto& b = m_blocks[m_current];
+  std::memcpy(b.data + b.frames * sizeof(HSI_FRAME_STRUCT), &frame, sizeof(HSI_FRAME_STRUCT));
+  if (++b.frames == m_frames_per_block) {
+    submit_current_block();
+  }
+}
+
+void
+HSICaptureWriter::submit_current_block()
+{
+  auto index = m_current;
+  m_current = SIZE_MAX;
+  auto& b = m_blocks[index];
+  auto used = b.frames * sizeof(HSI_FRAME_STRUCT);
+  std::memset(b.data + used, 0, m_config.buffer_size_bytes - used);
+  b.file->logical_size = b.offset + used;
+  b.submit_time = std::chrono::steady_clock::now();
+  m_backend->submit(index);
+}
+
+void
+HSICaptureWriter::release_block(std::size_t index, bool ok, std::size_t bytes)
+{
+  auto& b = m_blocks[index];
+  if (b.file) {
+    if (ok) {
+      m_frames_written.fetch_add(b.frames, std::memory_order_relaxed);
+      m_bytes_written.fetch_add(b.frames * sizeof(HSI_FRAME_STRUCT), std::memory_order_relaxed);
+    } else {
+      ++m_write_errors;
+      ers::error(HSICaptureIssue(ERS_HERE, b.file->path, "short or failed write of " + std::to_string(bytes) + " bytes"));
+    }
+    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>( // NOLINT(build/unsigned)
+                         std::chrono::steady_clock::now() - b.submit_time)
+                         .count();
+    if (latency > m_max_write_latency_us.load(std::memory_order_relaxed)) {
+      m_max_write_latency_us.store(latency, std::memory_order_relaxed);
+    }
+  }
+  b.file.reset();
+  b.frames = 0;
+  {
+    std::lock_guard<std::mutex> lk(m_free_mutex);
+    m_free_blocks.push_back(index);
+  }
+  m_free_cv.notify_all();
+}
+
+void
+HSICaptureWriter::wait_for_writes()
+{
+  std::unique_lock<std::mutex> lk(m_free_mutex);
+  m_free_cv.wait(lk, [&] { return m_free_blocks.size() == m_blocks.size(); });
+}
+
+void
+HSICaptureWriter::close()
+{
+  stop_timer();
+
+  {
+    std::lock_guard<std::mutex> lk(m_append_mutex);
+    if (!m_open.load()) {
+      return;
+    }
+    m_open.store(false, std::memory_order_release);
+    if (m_current != SIZE_MAX) {
+      if (m_blocks[m_current].frames > 0) {
+        submit_current_block();
+      } else {
+        auto index = m_current;
+        m_current = SIZE_MAX;
+        release_block(index, true, 0);
+      }
+    }
+    m_file.reset();
+  }
+  wait_for_writes();
+
+  auto stats = get_stats();
+  TLOG() << "Stopped raw HSI capture for run " << m_run_number << ": " << stats.frames_written << " frames in "
+         << m_file_index << " file(s), " << stats.frames_dropped << " dropped, " << stats.write_errors
+         << " write errors";
+}
+
+void
+HSICaptureWriter::close_after(std::chrono::milliseconds duration)
+{
+  stop_timer();
+  std::lock_guard<std::mutex> lk(m_timer_mutex);
+  m_timer_cancelled = false;
+  m_timer = std::thread([this, duration] {
+    {
+      std::unique_lock<std::mutex> timer_lk(m_timer_mutex);
+      if (m_timer_cv.wait_for(timer_lk, duration, [&] { return m_timer_cancelled; })) {
+        return;
+      }
+    }
+    TLOG() << "HSI capture duration of " << duration.count() << " ms elapsed";
+    // stop_timer() does not join the calling thread, so close() is safe here
+    close();
+  });
+}
+
+void
+HSICaptureWriter::stop_timer()
+{
+  {
+    std::lock_guard<std::mutex> lk(m_timer_mutex);
+    m_timer_cancelled = true;
+  }
+  m_timer_cv.notify_all();
+  if (m_timer.joinable() && m_timer.get_id() != std::this_thread::get_id()) {
+    m_timer.join();
+  }
+}
+
+HSICaptureWriter::Stats
+HSICaptureWriter::get_stats() const
+{
+  Stats stats;
+  stats.frames_written = m_frames_written.load();
+  stats.bytes_written = m_bytes_written.load();
+  stats.frames_dropped = m_frames_dropped.load();
+  stats.files_opened = m_files_opened.load();
+  stats.write_errors = m_write_errors.load();
+  stats.max_write_latency_us = m_max_write_latency_us.load();
+  {
+    std::lock_guard<std::mutex> lk(m_free_mutex);
+    stats.free_buffers = m_free_blocks.size();
+  }
+  return stats;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,176 @@
+/**
+ * @file HSICaptureWriter.hpp Asynchronous, rotating raw HSI frame capture
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSICAPTUREWRITER_HPP_
+#define HSILIBS_SRC_HSICAPTUREWRITER_HPP_
+
+#include "hsilibs/Types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Header at the start of every capture file, padded to one block.
+ *
+ * The file layout is: header block, then data blocks of block_size bytes,
+ * each holding frames_per_block HSI_FRAME_STRUCTs followed by zero padding.
+ * The last block is truncated to the frames it actually holds.
+ */
+struct HSICaptureFileHeader
+{
+  static constexpr uint64_t s_magic = 0x3130505443495348; // "HSICTP01" NOLINT(build/unsigned)
+  static constexpr uint32_t s_version = 1;                // NOLINT(build/unsigned)
+  static constexpr std::size_t s_header_block_size = 4096;
+
+  uint64_t magic = s_magic;        // NOLINT(build/unsigned)
+  uint32_t version = s_version;    // NOLINT(build/unsigned)
+  uint32_t header_size = s_header_block_size; // NOLINT(build/unsigned)
+  uint32_t frame_size = sizeof(HSI_FRAME_STRUCT); // NOLINT(build/unsigned)
+  uint32_t frames_per_block = 0;   // NOLINT(build/unsigned)
+  uint64_t block_size = 0;         // NOLINT(build/unsigned)
+  uint64_t run_number = 0;         // NOLINT(build/unsigned)
+  uint64_t clock_frequency_hz = 0; // NOLINT(build/unsigned)
+  uint32_t file_index = 0;         // NOLINT(build/unsigned)
+  uint32_t reserved = 0;           // NOLINT(build/unsigned)
+  int64_t creation_time_ns = 0;
+};
+
+/**
+ * @brief Appends raw HSI frames to a rotating set of binary files.
+ *
+ * append() only copies the frame into an aligned staging buffer; full
+ * buffers are written by an asynchronous backend (io_uring when built with
+ * liburing and enabled, a small pwrite thread pool otherwise). When no
+ * staging buffer is free, frames are dropped and counted rather than
+ * blocking the caller.
+ */
+class HSICaptureWriter
+{
+public:
+  struct Config
+  {
+    std::string directory = ".";
+    std::string file_prefix = "hsi_capture";
+    uint64_t max_file_size_bytes = 1ULL << 30; // NOLINT(build/unsigned)
+    uint32_t max_files = 0;                    // NOLINT(build/unsigned) 0: keep all files
+    std::size_t buffer_size_bytes = 1 << 20;
+    std::size_t num_buffers = 16;
+    std::size_t io_threads = 2;
+    bool use_io_uring = true;
+    bool direct_io = false;
+  };
+
+  struct Stats
+  {
+    uint64_t frames_written = 0; // NOLINT(build/unsigned)
+    uint64_t bytes_written = 0;  // NOLINT(build/unsigned)
+    uint64_t frames_dropped = 0; // NOLINT(build/unsigned)
+    uint64_t files_opened = 0;   // NOLINT(build/unsigned)
+    uint64_t write_errors = 0;   // NOLINT(build/unsigned)
+    uint64_t max_write_latency_us = 0; // NOLINT(build/unsigned)
+    uint32_t free_buffers = 0;   // NOLINT(build/unsigned)
+  };
+
+  explicit HSICaptureWriter(const Config& config);
+  ~HSICaptureWriter();
+
+  HSICaptureWriter(const HSICaptureWriter&) = delete;
+  HSICaptureWriter& operator=(const HSICaptureWriter&) = delete;
+
+  /**
+   * @brief Start a capture for the given run; returns false if no file could be opened
+   */
+  bool open(uint64_t run_number, uint64_t clock_frequency_hz); // NOLINT(build/unsigned)
+
+  /**
+   * @brief Flush the staging buffer and wait for all writes to complete
+   */
+  void close();
+
+  /**
+   * @brief Close the capture automatically once the duration has elapsed
+   */
+  void close_after(std::chrono::milliseconds duration);
+
+  bool is_open() const { return m_open.load(std::memory_order_acquire); }
+
+  void append(const HSI_FRAME_STRUCT& frame);
+
+  Stats get_stats() const;
+  const Config& get_config() const { return m_config; }
+  const char* backend_name() const;
+
+  class Backend;
+  struct File;
+
+private:
+  friend class Backend;
+
+  struct Block
+  {
+    char* data = nullptr;
+    std::size_t frames = 0;
+    std::shared_ptr<File> file;
+    uint64_t offset = 0; // NOLINT(build/unsigned)
+    std::chrono::steady_clock::time_point submit_time;
+  };
+
+  bool open_next_file();
+  void submit_current_block();
+  bool acquire_block();
+  void release_block(std::size_t index, bool ok, std::size_t bytes);
+  void wait_for_writes();
+  void stop_timer();
+
+  Config m_config;
+  std::size_t m_frames_per_block;
+
+  char* m_memory = nullptr;
+  std::vector<Block> m_blocks;
+  std::vector<std::size_t> m_free_blocks;
+  mutable std::mutex m_free_mutex;
+  std::condition_variable m_free_cv;
+  std::size_t m_current = SIZE_MAX;
+
+  std::unique_ptr<Backend> m_backend;
+
+  std::mutex m_append_mutex;
+  std::atomic<bool> m_open{ false };
+  uint64_t m_run_number = 0;         // NOLINT(build/unsigned)
+  uint64_t m_clock_frequency_hz = 0; // NOLINT(build/unsigned)
+  uint32_t m_file_index = 0;         // NOLINT(build/unsigned)
+  std::shared_ptr<File> m_file;
+  uint64_t m_file_offset = 0; // NOLINT(build/unsigned)
+  std::vector<std::string> m_file_paths;
+
+  std::thread m_timer;
+  std::mutex m_timer_mutex;
+  std::condition_variable m_timer_cv;
+  bool m_timer_cancelled = false;
+
+  std::atomic<uint64_t> m_frames_written{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_bytes_written{ 0 };  // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_frames_dropped{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_files_opened{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_write_errors{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_write_latency_us{ 0 }; // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSICAPTUREWRITER_HPP_
@@ -0,0 +1,53 @@
+/**
+ * @file HSIDataHandlingModel.hpp HSI data handling model, giving the data
+ * handler module access to its frame processor
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIDATAHANDLINGMODEL_HPP_
+#define HSILIBS_SRC_HSIDATAHANDLINGMODEL_HPP_
+
+#include "hsilibs/Types.hpp"
+#include "HSICaptureWriter.hpp"
+#include "HSIFrameProcessor.hpp"
+#include "HSILatencyBuffer.hpp"
+#include "HSIRequestHandler.hpp"
+
+#include "datahandlinglibs/models/DataHandlingModel.hpp"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace dunedaq {
+namespace hsilibs {
+
+class HSIDataHandlingModel
+  : public datahandlinglibs::DataHandlingModel<hsilibs::HSI_FRAME_STRUCT,
+                                               hsilibs::HSIRequestHandler,
+                                               hsilibs::HSILatencyBuffer,
+                                               hsilibs::HSIFrameProcessor>
+{
+public:
+  using inherited = datahandlinglibs::DataHandlingModel<hsilibs::HSI_FRAME_STRUCT,
+                                                        hsilibs::HSIRequestHandler,
+                                                        hsilibs::HSILatencyBuffer,
+                                                        hsilibs::HSIFrameProcessor>;
+
+  explicit HSIDataHandlingModel(std::atomic<bool>& run_marker)
+    : inherited(run_marker)
+  {}
+
+  // Hands the module's raw capture to the frame processor; after init(), before conf()
+  void set_capture_writer(std::shared_ptr<HSICaptureWriter> capture_writer)
+  {
+    m_raw_processor_impl->set_capture_writer(std::move(capture_writer));
+  }
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIDATAHANDLINGMODEL_HPP_
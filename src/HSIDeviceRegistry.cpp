@@ -0,0 +1,103 @@
+/**
+ * @file HSIDeviceRegistry.cpp Per-process sharing of uhal device handles
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSIDeviceRegistry.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSITransactionScheduler::acquire(Priority priority, std::chrono::milliseconds max_defer)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  auto self = std::this_thread::get_id();
+  if (m_depth > 0 && m_owner == self) {
+    ++m_depth;
+    return;
+  }
+
+  auto free = [&]() { return m_depth == 0; };
+
+  switch (priority) {
+    case Priority::kReadout:
+      ++m_readout_waiting;
+      m_cv.wait(lock, free);
+      --m_readout_waiting;
+      break;
+    case Priority::kControl:
+      m_cv.wait(lock, [&]() { return free() && m_readout_waiting == 0; });
+      break;
+    case Priority::kMonitoring: {
+      // wait for a readout poll to finish so we use the gap before the next one
+      auto seen = m_readout_sections_done;
+      auto deadline = std::chrono::steady_clock::now() + max_defer;
+      if (!m_cv.wait_until(
+            lock, deadline, [&]() { return free() && m_readout_waiting == 0 && m_readout_sections_done != seen; })) {
+        ++m_monitoring_deferred;
+        m_cv.wait(lock, [&]() { return free() && m_readout_waiting == 0; });
+      }
+      break;
+    }
+  }
+  m_owner = self;
+  m_depth = 1;
+  m_readout_priority = (priority == Priority::kReadout);
+}
+
+void
+HSITransactionScheduler::release()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_depth > 0) {
+      return;
+    }
+    m_owner = std::thread::id();
+    if (m_readout_priority) {
+      ++m_readout_sections_done;
+    }
+  }
+  m_cv.notify_all();
+}
+
+HSIDeviceRegistry&
+HSIDeviceRegistry::get()
+{
+  static HSIDeviceRegistry registry;
+  return registry;
+}
+
+HSISharedDevice
+HSIDeviceRegistry::acquire(const std::string& connections_file, const std::string& device_name, const factory_t& factory)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_entries[std::make_pair(connections_file, device_name)];
+
+  HSISharedDevice device{ entry.hw.lock(), entry.scheduler.lock(), entry.readiness.lock() };
+  if (device.hw && device.scheduler && device.readiness) {
+    TLOG_DEBUG(1) << "Sharing existing handle for device " << device_name;
+    return device;
+  }
+
+  device.hw = factory();
+  device.scheduler = std::make_shared<HSITransactionScheduler>();
+  device.readiness = std::make_shared<HSIReadinessTracker>();
+  entry.hw = device.hw;
+  entry.scheduler = device.scheduler;
+  entry.readiness = device.readiness;
+  TLOG_DEBUG(1) << "Opened new handle for device " << device_name;
+  return device;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,134 @@
+/**
+ * @file HSIDeviceRegistry.hpp Per-process sharing of uhal device handles
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIDEVICEREGISTRY_HPP_
+#define HSILIBS_SRC_HSIDEVICEREGISTRY_HPP_
+
+#include "HSIReadinessTracker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace uhal {
+class HwInterface;
+} // namespace uhal
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Serialises the IPbus transactions of all users of one device.
+ *
+ * Readout sections always go first. Control sections wait only for the
+ * device to be free. Monitoring sections are additionally held back until
+ * a readout section has just finished, so they land in the gap between two
+ * buffer polls; if no readout runs they go ahead after max_defer.
+ * Sections are re-entrant on the owning thread.
+ */
+class HSITransactionScheduler
+{
+public:
+  enum class Priority
+  {
+    kReadout,
+    kControl,
+    kMonitoring
+  };
+
+  class Section
+  {
+  public:
+    Section(HSITransactionScheduler& scheduler,
+            Priority priority,
+            std::chrono::milliseconds max_defer = std::chrono::milliseconds(100))
+      : m_scheduler(scheduler)
+    {
+      m_scheduler.acquire(priority, max_defer);
+    }
+    ~Section() { m_scheduler.release(); }
+    Section(const Section&) = delete;
+    Section& operator=(const Section&) = delete;
+
+  private:
+    HSITransactionScheduler& m_scheduler;
+  };
+
+  template<typename F>
+  auto run(Priority priority, F&& f, std::chrono::milliseconds max_defer = std::chrono::milliseconds(100))
+  {
+    Section section(*this, priority, max_defer);
+    return f();
+  }
+
+  uint64_t monitoring_sections_deferred() const { return m_monitoring_deferred; } // NOLINT(build/unsigned)
+
+private:
+  void acquire(Priority priority, std::chrono::milliseconds max_defer);
+  void release();
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::thread::id m_owner;
+  unsigned m_depth = 0;
+  bool m_readout_priority = false;
+  unsigned m_readout_waiting = 0;
+  uint64_t m_readout_sections_done = 0;             // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_monitoring_deferred{ 0 }; // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief A device handle, the scheduler guarding it and its last known readiness.
+ */
+struct HSISharedDevice
+{
+  std::shared_ptr<uhal::HwInterface> hw;
+  std::shared_ptr<HSITransactionScheduler> scheduler;
+  std::shared_ptr<HSIReadinessTracker> readiness;
+};
+
+/**
+ * @brief Hands out one handle per (connections file, device) pair and process.
+ *
+ * Entries are held weakly: the handle is closed once the last module that
+ * acquired it drops its reference.
+ */
+class HSIDeviceRegistry
+{
+public:
+  using factory_t = std::function<std::shared_ptr<uhal::HwInterface>()>;
+
+  static HSIDeviceRegistry& get();
+
+  HSISharedDevice acquire(const std::string& connections_file, const std::string& device_name, const factory_t& factory);
+
+private:
+  HSIDeviceRegistry() = default;
+
+  struct Entry
+  {
+    std::weak_ptr<uhal::HwInterface> hw;
+    std::weak_ptr<HSITransactionScheduler> scheduler;
+    std::weak_ptr<HSIReadinessTracker> readiness;
+  };
+
+  std::mutex m_mutex;
+  std::map<std::pair<std::string, std::string>, Entry> m_entries;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIDEVICEREGISTRY_HPP_
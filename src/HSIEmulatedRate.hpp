@@ -0,0 +1,51 @@
+/**
+ * @file HSIEmulatedRate.hpp Clock frequency and emulated event rate register
+ * of an HSI design
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIEMULATEDRATE_HPP_
+#define HSILIBS_SRC_HSIEMULATEDRATE_HPP_
+
+#include "timing/HSIDesignInterface.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Firmware clock frequency [Hz] of the design, the same value
+ * HSIDesignInterface::configure_hsi passes on to HSINode::configure_hsi.
+ */
+inline uint32_t // NOLINT(build/unsigned)
+read_hsi_clock_frequency(const timing::HSIDesignInterface* design)
+{
+  return design->get_io_node_plain()->read_firmware_frequency();
+}
+
+/**
+ * @brief Content of the emulated event rate register for a rate: the mean
+ * number of clock ticks between emulated events, as HSINode programs it.
+ */
+inline uint32_t // NOLINT(build/unsigned)
+hsi_rate_register_value(double rate, uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  return static_cast<uint32_t>(std::round(clock_frequency_hz / rate)); // NOLINT(build/unsigned)
+}
+
+inline uint32_t // NOLINT(build/unsigned)
+read_hsi_rate_register(const timing::HSINode& hsi_node)
+{
+  auto rate_register = hsi_node.getNode("csr.rate").read();
+  hsi_node.getClient().dispatch();
+  return rate_register.value();
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIEMULATEDRATE_HPP_
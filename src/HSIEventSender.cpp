@@ -8,6 +8,7 @@
  */
 
 #include "hsilibs/HSIEventSender.hpp"
+#include "HSITraceRing.hpp"
 
 #include "iomanager/IOManager.hpp"
 #include "logging/Logging.hpp"
@@ -69,6 +70,7 @@ HSIEventSender::send_hsi_event(dfmessages::HSIEvent& event)
                 << event.sequence_counter << "\n";
 
   bool was_successfully_sent = false;
+  uint16_t failed_attempts = 0; // NOLINT(build/unsigned)
   while (!was_successfully_sent) {
     try {
       dfmessages::HSIEvent event_copy(event);
@@ -81,17 +83,46 @@ HSIEventSender::send_hsi_event(dfmessages::HSIEvent& event)
       oss_warn << "push to output connection \"" << m_hsievent_send_connection << "\"";
       ers::error(dunedaq::iomanager::TimeoutExpired(ERS_HERE, get_name(), oss_warn.str(), m_queue_timeout.count()));
       ++m_failed_to_send_counter;
+      ++failed_attempts;
     }
   }
+  // status: number of timed out attempts before the send went through
+  hsi_trace(HSITraceStage::kSendEvent, failed_attempts, event.timestamp, event.header, event.signal_map, event.sequence_counter);
   if (m_sent_counter > 0 && m_sent_counter % 200000 == 0)
     TLOG_DEBUG(3) << "Have sent out " << m_sent_counter << " HSI events";
 }
 
-void
-HSIEventSender::send_raw_hsi_data(const std::array<uint32_t, 7>& raw_data, raw_sender_ct* sender)
+std::array<uint32_t, 7>
+HSIEventSender::make_raw_hsi_data(uint64_t timestamp, // NOLINT(build/unsigned)
+                                  uint32_t data,      // NOLINT(build/unsigned)
+                                  uint32_t trigger,   // NOLINT(build/unsigned)
+                                  uint32_t sequence,  // NOLINT(build/unsigned)
+                                  uint32_t source_id) // NOLINT(build/unsigned)
+{
+  std::array<uint32_t, 7> raw_data;
+  // DAQHeader, frame version: 1, det id: 1, crate/slot/link (bits 12-31): source id
+  raw_data[0] = ((source_id & HSI_FRAME_STRUCT::s_source_id_mask) << 12) | (0x1 << 6) | 0x1;
+  raw_data[1] = timestamp;
+  raw_data[2] = timestamp >> 32;
+  raw_data[3] = data;
+  raw_data[4] = 0x0;
+  raw_data[5] = trigger;
+  raw_data[6] = sequence;
+  return raw_data;
+}
+
+HSI_FRAME_STRUCT
+HSIEventSender::pack_raw_hsi_data(const std::array<uint32_t, 7>& raw_data)
 {
   HSI_FRAME_STRUCT payload;
   ::memcpy(&payload, &raw_data[0], sizeof(HSI_FRAME_STRUCT));
+  return payload;
+}
+
+void
+HSIEventSender::send_raw_hsi_data(const std::array<uint32_t, 7>& raw_data, raw_sender_ct* sender)
+{
+  HSI_FRAME_STRUCT payload = pack_raw_hsi_data(raw_data);
 
   TLOG_DEBUG(3) << get_name() << ": Sending HSI_FRAME_STRUCT " << std::hex << "0x" << payload.frame.version << ", 0x"
                 << payload.frame.detector_id
@@ -100,13 +131,16 @@ HSIEventSender::send_raw_hsi_data(const std::array<uint32_t, 7>& raw_data, raw_s
                 << payload.frame.input_low << "; 0x" << payload.frame.input_high << "; 0x" << payload.frame.trigger
                 << "; 0x" << payload.frame.sequence << std::endl;
 
+  uint64_t ts = raw_data[1] | (static_cast<uint64_t>(raw_data[2]) << 32); // NOLINT(build/unsigned)
   try {
     // TODO deal with this
     if (!sender) {
       throw(QueueIsNullFatalError(ERS_HERE, get_name(), "HSIEventSender output"));
     }
     sender->send(std::move(payload), m_queue_timeout);
+    hsi_trace(HSITraceStage::kSendRaw, 0, ts, 0, raw_data[5], raw_data[6]);
   } catch (const dunedaq::iomanager::TimeoutExpired& excpt) {
+    hsi_trace(HSITraceStage::kSendRaw, 1, ts, 0, raw_data[5], raw_data[6]);
     std::ostringstream oss_warn;
     oss_warn << "push to output raw hsi data queue failed";
     ers::error(dunedaq::iomanager::TimeoutExpired(ERS_HERE, get_name(), oss_warn.str(), m_queue_timeout.count()));
@@ -114,6 +148,22 @@ HSIEventSender::send_raw_hsi_data(const std::array<uint32_t, 7>& raw_data, raw_s
   }
 }
 
+void
+HSIEventSender::dump_trace_rings(const std::string& directory, const std::string& reason)
+{
+  auto files = HSITraceRegistry::get().dump(directory, get_name() + "/", reason);
+  if (files.empty()) {
+    TLOG() << get_name() << ": No HSI trace ring to dump (" << reason << ")";
+    return;
+  }
+  std::ostringstream oss;
+  oss << "dumped " << files.size() << " trace ring(s) (" << reason << "):";
+  for (auto& file : files) {
+    oss << " " << file;
+  }
+  ers::info(hsilibs::ProgressUpdate(ERS_HERE, get_name(), oss.str()));
+}
+
 } // namespace hsilibs
 } // namespace dunedaq
 
@@ -7,12 +7,19 @@
  * received with this code.
  */
 #include "hsilibs/Types.hpp"
+#include "hsilibs/Issues.hpp"
+#include "hsilibs/dal/HSIDataHandlerConf.hpp"
+#include "hsilibs/opmon/frame_processor_info.pb.h"
 #include "HSIFrameProcessor.hpp"
 
+#include "appmodel/DataHandlerModule.hpp"
+
+#include <algorithm>
 #include <atomic>
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace dunedaq {
 namespace hsilibs {
@@ -20,17 +27,233 @@ namespace hsilibs {
 void 
 HSIFrameProcessor::conf(const appmodel::DataHandlerModule* conf)
 {
-  // m_tasklist.push_back( std::bind(&HSIFrameProcessor::frame_error_check, this, std::placeholders::_1) );
+  auto hsi_conf = conf->get_module_configuration()->cast<dal::HSIDataHandlerConf>();
+  std::size_t processing_threads = 0;
+  std::size_t processing_queue_size = 0;
+  if (hsi_conf != nullptr) {
+    processing_threads = hsi_conf->get_processing_threads();
+    processing_queue_size = hsi_conf->get_processing_queue_size();
+  }
+  configure_tasks(processing_threads, processing_queue_size);
+
   inherited::conf(conf);
 }
 
+void
+HSIFrameProcessor::configure_tasks(std::size_t processing_threads, std::size_t processing_queue_size)
+{
+  m_processing_threads = processing_threads;
+  m_processing_queue_size = processing_queue_size;
+
+  auto& error_check =
+    add_task("frame_error_check", std::bind(&HSIFrameProcessor::frame_error_check, this, std::placeholders::_1));
+  HSIProcessingTask* capture = nullptr;
+  if (m_capture_writer != nullptr) {
+    capture = &add_task(
+      "raw_capture", [this](constframeptr fp) { m_capture_writer->append(*fp); });
+  }
+  HSIProcessingTask* statistics = nullptr;
+  if (m_post_processing_enabled) {
+    statistics = &add_task(
+      "signal_statistics", std::bind(&HSIFrameProcessor::signal_statistics, this, std::placeholders::_1));
+  }
+
+  if (m_processing_threads == 0) {
+    inherited::add_preprocess_task([&error_check](frameptr fp) { error_check(fp); });
+    if (capture != nullptr) {
+      inherited::add_preprocess_task([capture](frameptr fp) { (*capture)(fp); });
+    }
+    if (statistics != nullptr) {
+      inherited::add_postprocess_task([statistics](constframeptr fp) { (*statistics)(fp); });
+    }
+  } else {
+    // tasks only inspect frames, so they can run on copies in the worker pool
+    std::vector<HSIProcessingTask*> pool_tasks{ &error_check };
+    if (capture != nullptr) {
+      pool_tasks.push_back(capture);
+    }
+    if (statistics != nullptr) {
+      pool_tasks.push_back(statistics);
+    }
+    m_task_pool.set_tasks(pool_tasks);
+    inherited::add_preprocess_task([this](frameptr fp) {
+      if (m_task_pool.dispatch(*fp) && !m_backpressure_reported) {
+        ers::warning(HSIProcessingBackpressure(ERS_HERE, m_processing_queue_size));
+        m_backpressure_reported = true;
+      }
+    });
+    TLOG() << "HSI frame processing tasks will run on " << std::min(m_processing_threads, pool_tasks.size())
+           << " worker thread(s), at most one per task";
+  }
+}
+
+void
+HSIFrameProcessor::start(const nlohmann::json& args)
+{
+  m_signal_statistics.reset();
+  m_sources.clear();
+  m_problem_reported = false;
+  m_backpressure_reported = false;
+  m_ts_error_ctr = 0;
+  m_seq_gap_ctr = 0;
+  for (auto& task : m_tasks) {
+    task->reset_timing();
+  }
+  start_task_pool();
+  inherited::start(args);
+}
+
+void
+HSIFrameProcessor::stop(const nlohmann::json& args)
+{
+  inherited::stop(args);
+  stop_task_pool();
+  if (m_task_pool.dropped() > 0) {
+    ers::warning(HSIProcessingFramesLost(
+      ERS_HERE,
+      m_task_pool.dropped(),
+      m_capture_writer != nullptr ? "the raw capture of this run is incomplete" : "sequence checks may report false gaps"));
+  }
+
+  for (auto& task : m_tasks) {
+    if (task->calls() > 0) {
+      TLOG_DEBUG(2) << "HSI processing task " << task->name() << ": " << task->calls() << " calls, mean "
+                    << task->total_ns() / task->calls() << " ns, max " << task->max_ns() << " ns";
+    }
+  }
+}
+
+void
+HSIFrameProcessor::scrap(const nlohmann::json& args)
+{
+  // the pipeline functions registered in conf() refer to the tasks, drop them first
+  inherited::scrap(args);
+  m_task_pool.stop();
+  m_task_pool.set_tasks({});
+  std::lock_guard<std::mutex> lock(m_tasks_mutex);
+  m_tasks.clear();
+  m_capture_writer.reset();
+  m_processing_threads = 0;
+  m_processing_queue_size = 0;
+}
+
+HSIProcessingTask&
+HSIFrameProcessor::add_task(const std::string& name, HSIProcessingTask::function_t function)
+{
+  std::lock_guard<std::mutex> lock(m_tasks_mutex);
+  m_tasks.push_back(std::make_unique<HSIProcessingTask>(name, std::move(function)));
+  return *m_tasks.back();
+}
+
 /**
  * Pipeline Stage 2.: Check for errors
+ * Needs frames in arrival order: timestamps must increase and the
+ * (16 bit, wrapping) firmware sequence counter must not skip.
  * */
 void 
-HSIFrameProcessor::frame_error_check(frameptr /*fp*/)
+HSIFrameProcessor::frame_error_check(constframeptr fp)
+{
+  auto ts = fp->get_timestamp();
+  uint32_t seq = fp->frame.sequence; // NOLINT(build/unsigned)
+
+  auto [source, first_frame] = m_sources.try_emplace(fp->get_source_id());
+  auto& state = source->second;
+  if (!first_frame) {
+    bool ts_error = ts <= state.last_ts;
+    bool seq_gap = seq != state.last_seq + 1 && !(state.last_seq == 0xffff && seq == 0);
+    if (ts_error) {
+      ++m_ts_error_ctr;
+    }
+    if (seq_gap) {
+      ++m_seq_gap_ctr;
+    }
+    if ((ts_error || seq_gap) && !m_problem_reported) {
+      ers::warning(HSIFrameSequenceIssue(ERS_HERE, source->first, state.last_seq, seq, state.last_ts, ts));
+      m_problem_reported = true;
+    }
+  }
+  state.last_ts = ts;
+  state.last_seq = seq;
+}
+
+/**
+ * Post-processing: runs on the processor's post-processing thread, so the
+ * bit-scan over the frame batch stays off the ingest path.
+ * */
+void
+HSIFrameProcessor::signal_statistics(constframeptr fp)
+{
+  for (auto* frame = fp->begin(); frame != fp->end(); ++frame) {
+    m_signal_statistics.add(frame->get_timestamp(), frame->frame.trigger);
+  }
+}
+
+void
+HSIFrameProcessor::generate_opmon_data()
 {
-  // check error fields
+  inherited::generate_opmon_data();
+
+  opmon::HSIFrameErrors errors;
+  errors.set_timestamp_errors(m_ts_error_ctr.load());
+  errors.set_sequence_gaps(m_seq_gap_ctr.load());
+  publish(std::move(errors));
+
+  std::unique_lock<std::mutex> tasks_lock(m_tasks_mutex);
+  for (auto& task : m_tasks) {
+    auto calls = task->calls();
+    opmon::HSIProcessingTaskInfo task_info;
+    task_info.set_calls(calls);
+    task_info.set_total_time_us(task->total_ns() / 1000.);
+    task_info.set_max_time_ns(task->max_ns());
+    if (calls > 0) {
+      double mean_ns = static_cast<double>(task->total_ns()) / calls;
+      task_info.set_mean_time_ns(mean_ns);
+      task_info.set_max_rate_hz(mean_ns > 0. ? 1.e9 / mean_ns : 0.);
+    }
+    publish(std::move(task_info), { { "task", task->name() } });
+  }
+  tasks_lock.unlock();
+
+  if (m_task_pool.running()) {
+    opmon::HSIProcessingPoolInfo pool_info;
+    pool_info.set_workers(m_task_pool.num_workers());
+    pool_info.set_queued_frames(m_task_pool.occupancy());
+    pool_info.set_dropped_frames(m_task_pool.dropped());
+    pool_info.set_blocked_dispatches(m_task_pool.blocked());
+    publish(std::move(pool_info));
+  }
+
+  if (!m_post_processing_enabled) {
+    return;
+  }
+
+  auto snap = m_signal_statistics.snapshot();
+
+  opmon::HSIFrameStatistics info;
+  info.set_frames_processed(snap.frames);
+  info.set_frame_rate_hz(snap.frame_rate_hz);
+  info.set_empty_frames(snap.empty_frames);
+  info.set_signals_seen(snap.signals);
+  info.set_mean_signal_multiplicity(snap.mean_multiplicity);
+  info.set_fired_signal_mask(snap.fired_mask);
+  publish(std::move(info));
+
+  // only signals that have fired at least once are published
+  for (uint32_t bits = snap.fired_mask; bits; bits &= bits - 1) { // NOLINT(build/unsigned)
+    auto bit = __builtin_ctz(bits);
+    const auto& signal = snap.per_signal[bit];
+
+    opmon::HSISignalStatistics signal_info;
+    signal_info.set_count(signal.count);
+    signal_info.set_rate_hz(signal.rate_hz);
+    signal_info.set_last_seen_timestamp(signal.last_seen_timestamp);
+    signal_info.set_mean_interval_ticks(signal.mean_interval_ticks);
+    signal_info.set_min_interval_ticks(signal.min_interval_ticks);
+    signal_info.set_max_interval_ticks(signal.max_interval_ticks);
+    signal_info.set_p50_interval_ticks(signal.p50_interval_ticks);
+    signal_info.set_p99_interval_ticks(signal.p99_interval_ticks);
+    publish(std::move(signal_info), { { "signal", std::to_string(bit) } });
+  }
 }
 
 } // namespace hsilibs
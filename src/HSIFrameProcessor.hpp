@@ -16,10 +16,18 @@
 #include "datahandlinglibs/FrameErrorRegistry.hpp"
 #include "datahandlinglibs/ReadoutLogging.hpp"
 
+#include "HSICaptureWriter.hpp"
+#include "HSISignalStatistics.hpp"
+#include "HSITaskPool.hpp"
+
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace dunedaq {
 namespace hsilibs {
@@ -30,27 +38,86 @@ class HSIFrameProcessor : public datahandlinglibs::TaskRawDataProcessorModel<hsi
 public:
   using inherited = datahandlinglibs::TaskRawDataProcessorModel<hsilibs::HSI_FRAME_STRUCT>;
   using frameptr = hsilibs::HSI_FRAME_STRUCT*;
+  using constframeptr = const hsilibs::HSI_FRAME_STRUCT*;
   using timestamp_t = std::uint64_t; // NOLINT(build/unsigned)
 
   // Constructor
-  explicit HSIFrameProcessor(std::unique_ptr<datahandlinglibs::FrameErrorRegistry>& error_registry, bool /*post_processing*/)
-    : TaskRawDataProcessorModel<hsilibs::HSI_FRAME_STRUCT>(error_registry, false)
+  explicit HSIFrameProcessor(std::unique_ptr<datahandlinglibs::FrameErrorRegistry>& error_registry, bool post_processing)
+    : TaskRawDataProcessorModel<hsilibs::HSI_FRAME_STRUCT>(error_registry, post_processing)
+    , m_post_processing_enabled(post_processing)
   {}
 
   // Override config for pipeline setup
   void conf(const appmodel::DataHandlerModule* conf) override;
-  
+
+  // Raw capture of the owning data handler, nullptr for none; set before conf(), dropped by scrap()
+  void set_capture_writer(std::shared_ptr<HSICaptureWriter> capture_writer)
+  {
+    m_capture_writer = std::move(capture_writer);
+  }
+
+  void start(const nlohmann::json& args) override;
+  void stop(const nlohmann::json& args) override;
+  void scrap(const nlohmann::json& args) override;
+
 protected:
   /**
    * Pipeline Stage 2.: Check for error
    * */
-  void frame_error_check(frameptr /*fp*/);
+  void frame_error_check(constframeptr fp);
+
+  /**
+   * Post-processing: per-signal-bit counters, rates and inter-arrival times
+   * */
+  void signal_statistics(constframeptr fp);
+
+  void generate_opmon_data() override;
+
+  /**
+   * The processing tasks and where they run: inline on the consumer and
+   * post-processing threads, or on processing_threads pool workers fed by
+   * the preprocessing stage. conf() takes the settings from
+   * HSIDataHandlerConf; standalone users (benchmarks, tests) call it
+   * directly. The raw capture task is added if a capture writer is set.
+   * */
+  void configure_tasks(std::size_t processing_threads, std::size_t processing_queue_size);
+  void start_task_pool()
+  {
+    if (m_processing_threads > 0) {
+      m_task_pool.start(m_processing_threads, m_processing_queue_size, "hsi-proc");
+    }
+  }
+  void stop_task_pool() { m_task_pool.stop(); }
+  uint64_t task_pool_dropped() const { return m_task_pool.dropped(); } // NOLINT(build/unsigned)
 
   // Internals
   bool m_problem_reported = false;
   std::atomic<int> m_ts_error_ctr{ 0 };
+  std::atomic<int> m_seq_gap_ctr{ 0 };
+
+  // last timestamp and sequence counter seen from each source (HSI_FRAME_STRUCT::get_source_id)
+  struct SourceState
+  {
+    timestamp_t last_ts = 0;
+    uint32_t last_seq = 0; // NOLINT(build/unsigned)
+  };
+  std::unordered_map<uint32_t, SourceState> m_sources; // NOLINT(build/unsigned)
 
 private:
+  HSIProcessingTask& add_task(const std::string& name, HSIProcessingTask::function_t function);
+
+  bool m_post_processing_enabled;
+  bool m_backpressure_reported = false;
+  HSISignalStatistics m_signal_statistics;
+  std::shared_ptr<HSICaptureWriter> m_capture_writer;
+
+  // Frame processing tasks; with a worker pool configured they run on
+  // frame copies in the pool instead of on the consumer/post-processing threads
+  std::vector<std::unique_ptr<HSIProcessingTask>> m_tasks;
+  std::mutex m_tasks_mutex; // conf/scrap against opmon
+  HSITaskPool m_task_pool;
+  std::size_t m_processing_threads = 0;
+  std::size_t m_processing_queue_size = 0;
 };
 
 } // namespace hsilibs
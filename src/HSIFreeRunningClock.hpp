@@ -0,0 +1,52 @@
+/**
+ * @file HSIFreeRunningClock.hpp Timestamp source derived from the local
+ * steady clock
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIFREERUNNINGCLOCK_HPP_
+#define HSILIBS_SRC_HSIFREERUNNINGCLOCK_HPP_
+
+#include "utilities/TimestampEstimatorBase.hpp"
+
+#include <chrono>
+#include <cstdint>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief TimestampEstimatorBase that needs no TimeSync messages: timestamps
+ * count clock ticks from start_timestamp at the moment of construction, at
+ * the given clock frequency, using std::chrono::steady_clock.
+ */
+class HSIFreeRunningClock : public utilities::TimestampEstimatorBase
+{
+public:
+  HSIFreeRunningClock(uint64_t clock_frequency_hz, uint64_t start_timestamp) // NOLINT(build/unsigned)
+    : m_clock_frequency_hz(clock_frequency_hz)
+    , m_start_timestamp(start_timestamp)
+    , m_origin(std::chrono::steady_clock::now())
+  {}
+
+  uint64_t get_timestamp_estimate() const override // NOLINT(build/unsigned)
+  {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_origin).count();
+    // split seconds off so ns * frequency cannot overflow
+    uint64_t seconds = ns / 1000000000;   // NOLINT(build/unsigned)
+    uint64_t remainder = ns % 1000000000; // NOLINT(build/unsigned)
+    return m_start_timestamp + seconds * m_clock_frequency_hz + remainder * m_clock_frequency_hz / 1000000000;
+  }
+
+private:
+  uint64_t m_clock_frequency_hz; // NOLINT(build/unsigned)
+  uint64_t m_start_timestamp;    // NOLINT(build/unsigned)
+  std::chrono::steady_clock::time_point m_origin;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIFREERUNNINGCLOCK_HPP_
@@ -0,0 +1,159 @@
+/**
+ * @file HSIHardwareSequence.hpp IO reset, configure, start and readback
+ * sequences of an HSI endpoint, shared by the HSI controllers
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIHARDWARESEQUENCE_HPP_
+#define HSILIBS_SRC_HSIHARDWARESEQUENCE_HPP_
+
+#include "HSIEmulatedRate.hpp"
+
+#include "timing/HSIDesignInterface.hpp"
+#include "timing/timingfirmwareinfo/Structs.hpp"
+
+#include "uhal/uhal.hpp"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief What an hsi block is meant to be programmed with.
+ */
+struct HSISettings
+{
+  uint32_t data_source;       // NOLINT(build/unsigned)
+  uint32_t rising_edge_mask;  // NOLINT(build/unsigned)
+  uint32_t falling_edge_mask; // NOLINT(build/unsigned)
+  uint32_t invert_edge_mask;  // NOLINT(build/unsigned)
+  double trigger_rate;
+
+  template<typename HSIInfo>
+  bool matches(const HSIInfo& hsi_info) const
+  {
+    return hsi_info.re_mask == rising_edge_mask && hsi_info.fe_mask == falling_edge_mask &&
+           hsi_info.inv_mask == invert_edge_mask && hsi_info.source == data_source;
+  }
+};
+
+/**
+ * @brief IO reset of the design: soft, from a clock configuration file, or
+ * from a clock source when no file is given.
+ */
+inline void
+hsi_io_reset(const timing::HSIDesignInterface* design,
+             bool soft,
+             const std::string& clock_config,
+             uint32_t clock_source) // NOLINT(build/unsigned)
+{
+  if (soft) {
+    design->soft_reset_io();
+  } else if (!clock_config.empty()) {
+    design->reset_io(clock_config);
+  } else {
+    design->reset_io(static_cast<timing::ClockSource>(clock_source));
+  }
+}
+
+/**
+ * @brief hsi reset, endpoint reset and hsi configure queued into as few
+ * dispatches as possible. The endpoint reset dispatches the queued hsi
+ * reset, in order, with its own transactions. The clock frequency must be
+ * read beforehand since the read dispatches.
+ */
+inline void
+hsi_configure_batched(uhal::HwInterface& hw,
+                      const timing::HSIDesignInterface* design,
+                      uint32_t endpoint_id, // NOLINT(build/unsigned)
+                      uint32_t address,     // NOLINT(build/unsigned)
+                      const HSISettings& settings,
+                      uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  auto& hsi_node = design->get_hsi_node();
+  hsi_node.reset_hsi(false);
+  design->get_endpoint_node_plain(endpoint_id)->reset(address, 0);
+  hsi_node.configure_hsi(settings.data_source,
+                         settings.rising_edge_mask,
+                         settings.falling_edge_mask,
+                         settings.invert_edge_mask,
+                         settings.trigger_rate,
+                         clock_frequency_hz,
+                         false);
+  hw.dispatch();
+}
+
+/**
+ * @brief The same sequence one command and dispatch at a time, the fallback
+ * when the batched sequence does not read back as requested.
+ */
+inline void
+hsi_configure_stepwise(const timing::HSIDesignInterface* design,
+                       uint32_t endpoint_id, // NOLINT(build/unsigned)
+                       uint32_t address,     // NOLINT(build/unsigned)
+                       const HSISettings& settings)
+{
+  design->get_hsi_node().reset_hsi();
+  design->get_endpoint_node_plain(endpoint_id)->reset(address, 0);
+  design->configure_hsi(settings.data_source,
+                        settings.rising_edge_mask,
+                        settings.falling_edge_mask,
+                        settings.invert_edge_mask,
+                        settings.trigger_rate);
+}
+
+/**
+ * @brief Read back the hsi block and describe where it differs from the
+ * settings; empty if it matches.
+ */
+inline std::string
+hsi_configuration_mismatches(const timing::HSIDesignInterface* design,
+                             const HSISettings& settings,
+                             uint32_t clock_frequency_hz) // NOLINT(build/unsigned)
+{
+  timing::timingfirmwareinfo::TimingDeviceInfo device_info;
+  design->get_info(device_info);
+  auto& hsi_info = device_info.hsi_info;
+
+  std::ostringstream mismatches;
+  if (hsi_info.re_mask != settings.rising_edge_mask) {
+    mismatches << " rising edge mask 0x" << std::hex << hsi_info.re_mask;
+  }
+  if (hsi_info.fe_mask != settings.falling_edge_mask) {
+    mismatches << " falling edge mask 0x" << std::hex << hsi_info.fe_mask;
+  }
+  if (hsi_info.inv_mask != settings.invert_edge_mask) {
+    mismatches << " invert edge mask 0x" << std::hex << hsi_info.inv_mask;
+  }
+  if (hsi_info.source != settings.data_source) {
+    mismatches << " data source " << std::dec << hsi_info.source;
+  }
+  auto rate_register = read_hsi_rate_register(design->get_hsi_node());
+  if (rate_register != hsi_rate_register_value(settings.trigger_rate, clock_frequency_hz)) {
+    mismatches << " emulated rate register " << std::dec << rate_register;
+  }
+  return mismatches.str();
+}
+
+/**
+ * @brief start_hsi and a readback of the hsi enable bit in one dispatch;
+ * true if the block reads back enabled.
+ */
+inline bool
+hsi_start_batched(const timing::HSINode& hsi_node)
+{
+  hsi_node.start_hsi(false);
+  auto enabled = hsi_node.getNode("csr.ctrl.en").read();
+  hsi_node.getClient().dispatch();
+  return enabled.value() != 0;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIHARDWARESEQUENCE_HPP_
@@ -0,0 +1,135 @@
+/**
+ * @file HSILatencyBuffer.cpp HSI latency buffer sized from the expected
+ * rate and retention time, optionally backed by hugepages
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSILatencyBuffer.hpp"
+
+#include "appmodel/LatencyBuffer.hpp"
+#include "hsilibs/dal/HSILatencyBufferConf.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+namespace {
+constexpr std::size_t s_hugepage_size = 2UL << 20;
+}
+
+std::size_t
+HSILatencyBuffer::size_for_rate(double rate_hz, double retention_s, double margin)
+{
+  auto frames = std::ceil(rate_hz * retention_s * std::max(margin, 1.));
+  // one slot of the ring always stays empty
+  return std::max<std::size_t>(static_cast<std::size_t>(frames), 1) + 1;
+}
+
+void
+HSILatencyBuffer::conf(const appmodel::LatencyBuffer* cfg)
+{
+  auto hsi_cfg = cfg->cast<dal::HSILatencyBufferConf>();
+  if (hsi_cfg == nullptr) {
+    inherited::conf(cfg);
+    return;
+  }
+
+  std::size_t size = cfg->get_size();
+  if (hsi_cfg->get_expected_rate_hz() > 0 && hsi_cfg->get_retention_time_s() > 0) {
+    size = size_for_rate(hsi_cfg->get_expected_rate_hz(), hsi_cfg->get_retention_time_s(), hsi_cfg->get_size_margin());
+  }
+  size = std::max<std::size_t>(size, 2);
+
+  release_mapping();
+  inherited::free_memory();
+
+  if (!hsi_cfg->get_use_hugepages() || !map_storage(size, cfg->get_preallocation())) {
+    inherited::allocate_memory(size,
+                               cfg->get_numa_aware(),
+                               cfg->get_numa_node(),
+                               cfg->get_intrinsic_allocator(),
+                               cfg->get_alignment_size());
+    m_allocation_kind = "default";
+    if (records_ == nullptr) {
+      throw std::bad_alloc();
+    }
+    if (cfg->get_preallocation()) {
+      std::memset(static_cast<void*>(records_), 0, size_ * sizeof(hsilibs::HSI_FRAME_STRUCT));
+    }
+  }
+  readIndex_ = 0;
+  writeIndex_ = 0;
+
+  TLOG() << "HSI latency buffer: " << size_ << " frames (" << (size_ * sizeof(hsilibs::HSI_FRAME_STRUCT) >> 10)
+         << " KiB), allocation: " << m_allocation_kind << (cfg->get_preallocation() ? ", prefaulted" : "");
+}
+
+bool
+HSILatencyBuffer::map_storage(std::size_t n_elements, bool prefault)
+{
+  auto bytes = n_elements * sizeof(hsilibs::HSI_FRAME_STRUCT);
+  bytes = (bytes + s_hugepage_size - 1) / s_hugepage_size * s_hugepage_size;
+
+  // explicit hugetlb pages first; they are populated by the kernel when asked to
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | (prefault ? MAP_POPULATE : 0), -1, 0);
+  std::string kind = "hugetlb";
+  if (mapping == MAP_FAILED) {
+    // no reserved hugepages: ask for transparent hugepages on a normal mapping
+    mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (mapping == MAP_FAILED) {
+      TLOG() << "Hugepage mapping of " << bytes << " bytes for the HSI latency buffer failed, using default allocation";
+      return false;
+    }
+    kind = (::madvise(mapping, bytes, MADV_HUGEPAGE) == 0) ? "transparent-hugepages" : "mmap";
+    if (prefault) {
+      std::memset(mapping, 0, bytes);
+    }
+  }
+
+  m_mapping = mapping;
+  m_mapping_bytes = bytes;
+  m_allocation_kind = kind;
+  records_ = static_cast<hsilibs::HSI_FRAME_STRUCT*>(mapping);
+  size_ = n_elements;
+  numa_aware_ = false;
+  intrinsic_allocator_ = false;
+  return true;
+}
+
+void
+HSILatencyBuffer::release_mapping()
+{
+  if (m_mapping == nullptr) {
+    return;
+  }
+  // the base class must not try to free() the mapping
+  ::munmap(m_mapping, m_mapping_bytes);
+  m_mapping = nullptr;
+  m_mapping_bytes = 0;
+  records_ = nullptr;
+  size_ = 0;
+  readIndex_ = 0;
+  writeIndex_ = 0;
+}
+
+void
+HSILatencyBuffer::scrap(const nlohmann::json& args)
+{
+  release_mapping();
+  inherited::scrap(args);
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,69 @@
+/**
+ * @file HSILatencyBuffer.hpp HSI latency buffer sized from the expected
+ * rate and retention time, optionally backed by hugepages
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSILATENCYBUFFER_HPP_
+#define HSILIBS_SRC_HSILATENCYBUFFER_HPP_
+
+#include "hsilibs/Types.hpp"
+
+#include "datahandlinglibs/models/BinarySearchQueueModel.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief BinarySearchQueueModel for HSI frames with HSI specific allocation.
+ *
+ * With an HSILatencyBufferConf the capacity can be derived from the expected
+ * frame rate and retention time, and the storage can come from an anonymous
+ * hugepage mapping (explicit hugetlb pages, then transparent hugepages, then
+ * the default allocator). With the LatencyBuffer preallocation flag set the
+ * storage is prefaulted at configure time so the first burst of a run does not
+ * take page faults on the data handler thread.
+ */
+class HSILatencyBuffer : public datahandlinglibs::BinarySearchQueueModel<hsilibs::HSI_FRAME_STRUCT>
+{
+public:
+  using inherited = datahandlinglibs::BinarySearchQueueModel<hsilibs::HSI_FRAME_STRUCT>;
+
+  HSILatencyBuffer()
+    : inherited()
+  {}
+
+  explicit HSILatencyBuffer(std::size_t size)
+    : inherited(size)
+  {}
+
+  ~HSILatencyBuffer() { release_mapping(); }
+
+  void conf(const appmodel::LatencyBuffer* cfg) override;
+  void scrap(const nlohmann::json& args) override;
+
+  /**
+   * @brief Capacity needed to hold retention_s of frames at rate_hz, with margin
+   */
+  static std::size_t size_for_rate(double rate_hz, double retention_s, double margin);
+
+  const std::string& allocation_kind() const { return m_allocation_kind; }
+
+private:
+  bool map_storage(std::size_t n_elements, bool prefault);
+  void release_mapping();
+
+  void* m_mapping = nullptr;
+  std::size_t m_mapping_bytes = 0;
+  std::string m_allocation_kind = "default";
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSILATENCYBUFFER_HPP_
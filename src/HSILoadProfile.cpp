@@ -0,0 +1,114 @@
+/**
+ * @file HSILoadProfile.cpp Piecewise rate profile for the fake HSI generator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSILoadProfile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+HSILoadProfile::Shape
+HSILoadProfile::shape_from_string(const std::string& shape)
+{
+  if (shape == "ramp") {
+    return Shape::kRamp;
+  }
+  if (shape == "sine") {
+    return Shape::kSine;
+  }
+  if (shape == "burst_train") {
+    return Shape::kBurstTrain;
+  }
+  return Shape::kStep;
+}
+
+const char*
+HSILoadProfile::shape_name(Shape shape)
+{
+  switch (shape) {
+    case Shape::kRamp:
+      return "ramp";
+    case Shape::kSine:
+      return "sine";
+    case Shape::kBurstTrain:
+      return "burst_train";
+    default:
+      return "step";
+  }
+}
+
+void
+HSILoadProfile::set_segments(std::vector<Segment> segments, bool loop)
+{
+  // zero-length segments would never be active
+  segments.erase(std::remove_if(segments.begin(), segments.end(), [](const Segment& s) { return s.duration_s <= 0; }),
+                 segments.end());
+  m_segments = std::move(segments);
+  m_loop = loop;
+  m_duration = 0.;
+  for (auto& s : m_segments) {
+    m_duration += s.duration_s;
+  }
+}
+
+double
+HSILoadProfile::segment_rate(const Segment& segment, double t)
+{
+  double rate = segment.rate_hz;
+  switch (segment.shape) {
+    case Shape::kRamp:
+      rate += (segment.secondary_rate_hz - segment.rate_hz) * std::min(t / segment.duration_s, 1.);
+      break;
+    case Shape::kSine:
+      if (segment.period_s > 0) {
+        rate += segment.amplitude_hz * std::sin(2 * M_PI * t / segment.period_s);
+      }
+      break;
+    case Shape::kBurstTrain:
+      if (segment.period_s > 0 && std::fmod(t, segment.period_s) >= segment.duty_cycle * segment.period_s) {
+        rate = segment.secondary_rate_hz;
+      }
+      break;
+    default:
+      break;
+  }
+  return std::max(rate, 0.);
+}
+
+double
+HSILoadProfile::rate_at(double t, std::size_t& segment) const
+{
+  segment = m_segments.size();
+  if (m_segments.empty()) {
+    return 0.;
+  }
+  if (t >= m_duration) {
+    if (!m_loop) {
+      auto& last = m_segments.back();
+      return segment_rate(last, last.duration_s);
+    }
+    t = std::fmod(t, m_duration);
+  }
+  for (std::size_t i = 0; i < m_segments.size(); ++i) {
+    if (t < m_segments[i].duration_s) {
+      segment = i;
+      return segment_rate(m_segments[i], t);
+    }
+    t -= m_segments[i].duration_s;
+  }
+  // rounding at the very end of the profile
+  segment = m_segments.size() - 1;
+  return segment_rate(m_segments.back(), m_segments.back().duration_s);
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
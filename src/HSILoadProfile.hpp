@@ -0,0 +1,78 @@
+/**
+ * @file HSILoadProfile.hpp Piecewise rate profile for the fake HSI generator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSILOADPROFILE_HPP_
+#define HSILIBS_SRC_HSILOADPROFILE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Sequence of rate segments, evaluated against the time since the
+ * profile was started.
+ *
+ * step: constant rate_hz. ramp: linear from rate_hz to secondary_rate_hz.
+ * sine: rate_hz + amplitude_hz * sin(2 pi t / period_s). burst_train: rate_hz
+ * for the first duty_cycle of every period_s, secondary_rate_hz otherwise.
+ * Negative rates are clamped to 0.
+ */
+class HSILoadProfile
+{
+public:
+  enum class Shape
+  {
+    kStep,
+    kRamp,
+    kSine,
+    kBurstTrain
+  };
+
+  struct Segment
+  {
+    Shape shape = Shape::kStep;
+    double duration_s = 0.;
+    double rate_hz = 0.;
+    double secondary_rate_hz = 0.;
+    double amplitude_hz = 0.;
+    double period_s = 1.;
+    double duty_cycle = 0.5;
+  };
+
+  static Shape shape_from_string(const std::string& shape);
+  static const char* shape_name(Shape shape);
+
+  void set_segments(std::vector<Segment> segments, bool loop);
+  void clear() { set_segments({}, false); }
+
+  bool empty() const { return m_segments.empty(); }
+  std::size_t size() const { return m_segments.size(); }
+  const Segment& segment(std::size_t index) const { return m_segments.at(index); }
+  double duration() const { return m_duration; }
+
+  /**
+   * @brief Rate at t seconds into the profile. segment is set to the active
+   * segment index, or to size() once a non-looping profile has ended, in
+   * which case the final rate of the last segment is returned.
+   */
+  double rate_at(double t, std::size_t& segment) const;
+
+  static double segment_rate(const Segment& segment, double t);
+
+private:
+  std::vector<Segment> m_segments;
+  bool m_loop = false;
+  double m_duration = 0.;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSILOADPROFILE_HPP_
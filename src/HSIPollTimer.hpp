@@ -0,0 +1,126 @@
+/**
+ * @file HSIPollTimer.hpp Per-iteration timing of a hardware polling loop
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIPOLLTIMER_HPP_
+#define HSILIBS_SRC_HSIPOLLTIMER_HPP_
+
+#include "LogHistogram.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Histograms of how regular a polling loop is and where its time goes.
+ *
+ * Per iteration: the start-to-start period, its excess over the scheduled
+ * period, and the time spent in the hardware read, in decoding and in
+ * sending. All values are in ns. Filled by the polling thread only; other
+ * threads may read the histograms at any time.
+ */
+class HSIPollTimer
+{
+public:
+  using clock_t = std::chrono::steady_clock;
+  using histogram_t = LogHistogram<40>;
+
+  void reset(std::chrono::nanoseconds scheduled_period)
+  {
+    m_scheduled_period_ns = scheduled_period.count();
+    m_period_ns.reset();
+    m_overshoot_ns.reset();
+    m_read_ns.reset();
+    m_decode_ns.reset();
+    m_send_ns.reset();
+    m_busy_ns.store(0, std::memory_order_relaxed);
+    m_last_start = clock_t::time_point();
+    m_active_ns.store(0, std::memory_order_relaxed);
+  }
+
+  // call at the top of every iteration
+  clock_t::time_point begin_iteration()
+  {
+    auto now = clock_t::now();
+    if (m_last_start != clock_t::time_point()) {
+      uint64_t period = elapsed_ns(m_last_start, now); // NOLINT(build/unsigned)
+      m_period_ns.fill(period);
+      m_overshoot_ns.fill(period > m_scheduled_period_ns ? period - m_scheduled_period_ns : 0);
+      m_active_ns.store(m_active_ns.load(std::memory_order_relaxed) + period, std::memory_order_relaxed);
+    }
+    m_last_start = now;
+    return now;
+  }
+
+  void record_read(uint64_t ns) { m_read_ns.fill(ns); }     // NOLINT(build/unsigned)
+  void record_decode(uint64_t ns) { m_decode_ns.fill(ns); } // NOLINT(build/unsigned)
+  void record_send(uint64_t ns) { m_send_ns.fill(ns); }     // NOLINT(build/unsigned)
+
+  // call once the work of the iteration is done, before waiting for the next one
+  void end_iteration(clock_t::time_point iteration_start)
+  {
+    m_busy_ns.store(m_busy_ns.load(std::memory_order_relaxed) + elapsed_ns(iteration_start, clock_t::now()),
+                    std::memory_order_relaxed);
+  }
+
+  static uint64_t elapsed_ns(clock_t::time_point from, clock_t::time_point to) // NOLINT(build/unsigned)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+  }
+
+  uint64_t scheduled_period_ns() const { return m_scheduled_period_ns; } // NOLINT(build/unsigned)
+  const histogram_t& period_ns() const { return m_period_ns; }
+  const histogram_t& overshoot_ns() const { return m_overshoot_ns; }
+  const histogram_t& read_ns() const { return m_read_ns; }
+  const histogram_t& decode_ns() const { return m_decode_ns; }
+  const histogram_t& send_ns() const { return m_send_ns; }
+
+  // fraction of the completed periods spent working rather than waiting
+  double duty_cycle() const
+  {
+    auto active = m_active_ns.load(std::memory_order_relaxed);
+    if (active == 0) {
+      return 0.;
+    }
+    return std::min(1., static_cast<double>(m_busy_ns.load(std::memory_order_relaxed)) / active);
+  }
+
+  std::string summary() const
+  {
+    std::ostringstream oss;
+    oss << "polls: " << m_read_ns.count() << ", scheduled period: " << m_scheduled_period_ns / 1000 << " us"
+        << ", period mean/p99/max: " << m_period_ns.mean() / 1000 << "/" << m_period_ns.quantile(0.99) / 1000 << "/"
+        << m_period_ns.max() / 1000 << " us"
+        << ", read p50/p99/max: " << m_read_ns.quantile(0.5) / 1000 << "/" << m_read_ns.quantile(0.99) / 1000 << "/"
+        << m_read_ns.max() / 1000 << " us"
+        << ", decode p99: " << m_decode_ns.quantile(0.99) / 1000 << " us"
+        << ", send p99: " << m_send_ns.quantile(0.99) / 1000 << " us"
+        << ", duty cycle: " << duty_cycle();
+    return oss.str();
+  }
+
+private:
+  uint64_t m_scheduled_period_ns = 0; // NOLINT(build/unsigned)
+  histogram_t m_period_ns;
+  histogram_t m_overshoot_ns;
+  histogram_t m_read_ns;
+  histogram_t m_decode_ns;
+  histogram_t m_send_ns;
+  std::atomic<uint64_t> m_busy_ns{ 0 };   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_active_ns{ 0 }; // NOLINT(build/unsigned)
+  clock_t::time_point m_last_start;       // polling thread only
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIPOLLTIMER_HPP_
@@ -0,0 +1,92 @@
+/**
+ * @file HSIRateController.hpp Schedule-debt tracking for the fake HSI
+ * generator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIRATECONTROLLER_HPP_
+#define HSILIBS_SRC_HSIRATECONTROLLER_HPP_
+
+#include "LogHistogram.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Tracks how late each generated event is with respect to its
+ * nominal time and decides what to do about it.
+ *
+ * With the catch_up policy every scheduled event is emitted, and a backlog
+ * is worked off as a burst. With the drop policy, events later than
+ * max_lateness are dropped and counted, so the generator rejoins its
+ * schedule instead of running behind it.
+ *
+ * late() is called from the generator thread only; the statistics can be
+ * read from any thread.
+ */
+class HSIRateController
+{
+public:
+  enum class Policy
+  {
+    kCatchUp,
+    kDrop
+  };
+
+  static Policy policy_from_string(const std::string& policy) { return policy == "drop" ? Policy::kDrop : Policy::kCatchUp; }
+
+  void configure(Policy policy, double max_lateness_s)
+  {
+    m_policy = policy;
+    m_max_lateness_s = max_lateness_s > 0 ? max_lateness_s : 0.;
+  }
+
+  void reset()
+  {
+    m_lateness_us.reset();
+    m_debt_us.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Account for an event that is lateness_s behind its nominal time.
+   * Returns true if the event should be dropped.
+   */
+  bool late(double lateness_s)
+  {
+    uint64_t lateness_us = lateness_s > 0 ? static_cast<uint64_t>(lateness_s * 1.e6) : 0; // NOLINT(build/unsigned)
+    m_debt_us.store(lateness_us, std::memory_order_relaxed);
+    if (m_policy == Policy::kDrop && lateness_s > m_max_lateness_s) {
+      m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return true;
+    }
+    m_lateness_us.fill(lateness_us);
+    return false;
+  }
+
+  Policy policy() const { return m_policy; }
+  // lateness of the most recent event
+  uint64_t schedule_debt_us() const { return m_debt_us.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }          // NOLINT(build/unsigned)
+  // lateness of the emitted events
+  const LogHistogram<32>& lateness_us() const { return m_lateness_us; }
+
+private:
+  Policy m_policy = Policy::kCatchUp;
+  double m_max_lateness_s = 0.;
+
+  LogHistogram<32> m_lateness_us;
+  std::atomic<uint64_t> m_debt_us{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_dropped{ 0 }; // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIRATECONTROLLER_HPP_
@@ -0,0 +1,109 @@
+/**
+ * @file HSIReadinessTracker.cpp Cached HSI device readiness with change notification
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSIReadinessTracker.hpp"
+
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSIReadinessTracker::update(bool ready)
+{
+  auto now = clock_t::now();
+  m_last_update.store(now.time_since_epoch().count(), std::memory_order_relaxed);
+  m_updates.fetch_add(1, std::memory_order_relaxed);
+
+  std::vector<callback_t> to_notify;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_ready.load(std::memory_order_relaxed) == ready) {
+      return;
+    }
+    m_ready.store(ready, std::memory_order_release);
+    m_last_transition = now;
+    ++(ready ? m_became_ready : m_became_not_ready);
+    to_notify.reserve(m_callbacks.size());
+    for (auto& [id, callback] : m_callbacks) {
+      to_notify.push_back(callback);
+    }
+  }
+  m_cv.notify_all();
+  for (auto& callback : to_notify) {
+    callback(ready, now);
+  }
+}
+
+void
+HSIReadinessTracker::reset()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ready.store(false, std::memory_order_release);
+    m_last_update.store(0, std::memory_order_relaxed);
+    m_update_period.store(0, std::memory_order_relaxed);
+  }
+  m_cv.notify_all();
+}
+
+bool
+HSIReadinessTracker::fresh(clock_t::duration max_age) const
+{
+  auto last = m_last_update.load(std::memory_order_relaxed);
+  if (last == 0) {
+    return false;
+  }
+  return clock_t::now() - clock_t::time_point(clock_t::duration(last)) <= max_age;
+}
+
+void
+HSIReadinessTracker::set_update_period(clock_t::duration period)
+{
+  m_update_period.store(period.count(), std::memory_order_relaxed);
+}
+
+bool
+HSIReadinessTracker::fresh() const
+{
+  auto period = m_update_period.load(std::memory_order_relaxed);
+  return period > 0 && fresh(clock_t::duration(period));
+}
+
+bool
+HSIReadinessTracker::wait_for(bool ready, clock_t::duration timeout) const
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_cv.wait_for(lock, timeout, [&]() { return m_ready.load(std::memory_order_relaxed) == ready; });
+}
+
+int
+HSIReadinessTracker::subscribe(callback_t callback)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto id = m_next_callback_id++;
+  m_callbacks.emplace(id, std::move(callback));
+  return id;
+}
+
+void
+HSIReadinessTracker::unsubscribe(int id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_callbacks.erase(id);
+}
+
+HSIReadinessTracker::clock_t::time_point
+HSIReadinessTracker::last_transition() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_last_transition;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,83 @@
+/**
+ * @file HSIReadinessTracker.hpp Cached HSI device readiness with change notification
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIREADINESSTRACKER_HPP_
+#define HSILIBS_SRC_HSIREADINESSTRACKER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Last known readiness of an HSI device, published by whoever reads the hardware.
+ *
+ * Readers get the cached value without touching the device, can block until
+ * a given state is reached, or register a callback that runs on every
+ * transition. Callbacks run on the publishing thread, outside the lock.
+ */
+class HSIReadinessTracker
+{
+public:
+  using clock_t = std::chrono::steady_clock;
+  using callback_t = std::function<void(bool ready, clock_t::time_point when)>;
+
+  // record a fresh readback; notifies only when the state changes
+  void update(bool ready);
+  // forget the state, e.g. when the publisher stops; waiters see "not ready"
+  void reset();
+
+  bool ready() const { return m_ready.load(std::memory_order_acquire); }
+
+  // true if the last update is no older than max_age
+  bool fresh(clock_t::duration max_age) const;
+
+  // longest expected gap between two updates of the publisher; zero (the default) means unknown
+  void set_update_period(clock_t::duration period);
+  // true if the last update is no older than the publisher's update period, i.e. the
+  // publisher has not yet missed a readback; always false while the period is unknown
+  bool fresh() const;
+
+  // block until the device is in the wanted state; false on timeout
+  bool wait_for(bool ready, clock_t::duration timeout) const;
+
+  int subscribe(callback_t callback);
+  void unsubscribe(int id);
+
+  uint64_t updates() const { return m_updates.load(std::memory_order_relaxed); }       // NOLINT(build/unsigned)
+  uint64_t became_ready() const { return m_became_ready.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t became_not_ready() const                                                    // NOLINT(build/unsigned)
+  {
+    return m_became_not_ready.load(std::memory_order_relaxed);
+  }
+  clock_t::time_point last_transition() const;
+
+private:
+  std::atomic<bool> m_ready{ false };
+  std::atomic<uint64_t> m_updates{ 0 };          // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_became_ready{ 0 };     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_became_not_ready{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<clock_t::rep> m_last_update{ 0 };
+  std::atomic<clock_t::rep> m_update_period{ 0 };
+
+  mutable std::mutex m_mutex;
+  mutable std::condition_variable m_cv;
+  clock_t::time_point m_last_transition;
+  std::map<int, callback_t> m_callbacks;
+  int m_next_callback_id = 0;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIREADINESSTRACKER_HPP_
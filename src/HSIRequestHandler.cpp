@@ -0,0 +1,222 @@
+/**
+ * @file HSIRequestHandler.cpp HSI specific request handler with a
+ * fragment-assembly cache for overlapping data requests
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSIRequestHandler.hpp"
+
+#include "hsilibs/dal/HSIDataHandlerConf.hpp"
+#include "hsilibs/opmon/request_handler_info.pb.h"
+
+#include "appmodel/DataHandlerModule.hpp"
+#include "daqdataformats/Fragment.hpp"
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSIRequestHandler::conf(const appmodel::DataHandlerModule* conf)
+{
+  auto hsi_conf = conf->get_module_configuration()->cast<dal::HSIDataHandlerConf>();
+  set_cache_size(hsi_conf != nullptr ? hsi_conf->get_request_cache_size() : 0);
+  TLOG_DEBUG(2) << "HSI request fragment cache size: " << m_cache_size;
+  inherited::conf(conf);
+}
+
+void
+HSIRequestHandler::start(const nlohmann::json& args)
+{
+  {
+    std::lock_guard<std::mutex> lk(m_cache_mutex);
+    m_cache.clear();
+  }
+  m_requests = 0;
+  m_cache_hits = 0;
+  m_cache_partial_hits = 0;
+  m_cache_misses = 0;
+  m_pieces_found = 0;
+  m_pieces_copied = 0;
+  inherited::start(args);
+}
+
+std::shared_ptr<const HSIRequestHandler::frames_t>
+HSIRequestHandler::cache_lookup(timestamp_t begin, timestamp_t& cached_end)
+{
+  std::lock_guard<std::mutex> lk(m_cache_mutex);
+  CacheEntry* best = nullptr;
+  for (auto& entry : m_cache) {
+    // reusable when the request starts inside a cached window
+    if (entry.window_begin <= begin && begin < entry.window_end &&
+        (best == nullptr || entry.window_end > best->window_end)) {
+      best = &entry;
+    }
+  }
+  if (best == nullptr) {
+    return nullptr;
+  }
+  best->last_used = ++m_cache_clock;
+  cached_end = best->window_end;
+  return best->frames;
+}
+
+void
+HSIRequestHandler::cache_insert(timestamp_t begin,
+                                timestamp_t end,
+                                const std::vector<std::pair<void*, size_t>>& pieces)
+{
+  auto frames = std::make_shared<frames_t>();
+  for (auto& piece : pieces) {
+    auto* first = static_cast<const hsilibs::HSI_FRAME_STRUCT*>(piece.first);
+    frames->insert(frames->end(), first, first + piece.second / sizeof(hsilibs::HSI_FRAME_STRUCT));
+  }
+
+  std::lock_guard<std::mutex> lk(m_cache_mutex);
+  CacheEntry entry{ begin, end, std::move(frames), ++m_cache_clock };
+  if (m_cache.size() < m_cache_size) {
+    m_cache.push_back(std::move(entry));
+    return;
+  }
+  auto lru = std::min_element(m_cache.begin(), m_cache.end(), [](const CacheEntry& a, const CacheEntry& b) {
+    return a.last_used < b.last_used;
+  });
+  *lru = std::move(entry);
+}
+
+HSIRequestHandler::RequestResult
+HSIRequestHandler::data_request(dfmessages::DataRequest dr)
+{
+  // the generic path deals with (and warns about) an empty buffer
+  if (m_latency_buffer->occupancy() == 0) {
+    return inherited::data_request(dr);
+  }
+
+  ++m_requests;
+  RequestResult rres(ResultCode::kUnknown, dr);
+  auto frag_header = create_fragment_header(dr);
+
+  timestamp_t begin = dr.request_information.window_begin;
+  timestamp_t end = dr.request_information.window_end;
+
+  std::vector<std::pair<void*, size_t>> frag_pieces;
+  std::shared_ptr<const frames_t> cached; // keeps the cached frames alive until the fragment is built
+  timestamp_t cached_end = 0;
+  if (m_cache_size > 0) {
+    cached = cache_lookup(begin, cached_end);
+  }
+
+  if (cached != nullptr) {
+    auto by_ts = [](const hsilibs::HSI_FRAME_STRUCT& frame, timestamp_t ts) { return frame.get_timestamp() < ts; };
+    auto first = std::lower_bound(cached->begin(), cached->end(), begin, by_ts);
+    auto last = std::lower_bound(first, cached->end(), std::min(end, cached_end), by_ts);
+    if (first != last) {
+      frag_pieces.emplace_back(const_cast<hsilibs::HSI_FRAME_STRUCT*>(&*first), // NOLINT
+                               std::distance(first, last) * sizeof(hsilibs::HSI_FRAME_STRUCT));
+    }
+
+    if (end <= cached_end) {
+      ++m_cache_hits;
+      rres.result_code = ResultCode::kFound;
+    } else {
+      // only the part of the window after the cached one is searched for
+      ++m_cache_partial_hits;
+      RequestResult tail(ResultCode::kUnknown, dr);
+      auto tail_pieces = get_fragment_pieces(cached_end, end, tail);
+      m_pieces_found += tail_pieces.size();
+      coalesce_fragment_pieces(tail_pieces);
+      frag_pieces.insert(frag_pieces.end(), tail_pieces.begin(), tail_pieces.end());
+      switch (tail.result_code) {
+        case ResultCode::kFound:
+          rres.result_code = ResultCode::kFound;
+          break;
+        case ResultCode::kNotYet:
+          // the window ends in the future: answer like the generic path so the request is retried
+          rres.result_code = ResultCode::kNotYet;
+          frag_pieces.clear();
+          break;
+        case ResultCode::kTooOld:
+        case ResultCode::kPartiallyOld:
+          rres.result_code = ResultCode::kPartiallyOld;
+          break;
+        default:
+          rres.result_code = ResultCode::kPartial;
+      }
+    }
+  } else {
+    ++m_cache_misses;
+    frag_pieces = get_fragment_pieces(begin, end, rres);
+    m_pieces_found += frag_pieces.size();
+    coalesce_fragment_pieces(frag_pieces);
+    if (m_cache_size > 0 && rres.result_code == ResultCode::kFound) {
+      cache_insert(begin, end, frag_pieces);
+    }
+  }
+  m_pieces_copied += frag_pieces.size();
+
+  account_result(rres.result_code, frag_header);
+
+  // one copy out of the (at most a few) contiguous pieces
+  rres.fragment = std::make_unique<daqdataformats::Fragment>(frag_pieces);
+  rres.fragment->set_header_fields(frag_header);
+  return rres;
+}
+
+// same error bits and request counters as DefaultRequestHandlerModel::data_request
+void
+HSIRequestHandler::account_result(ResultCode result_code, daqdataformats::FragmentHeader& frag_header)
+{
+  constexpr auto incomplete = 0x1 << static_cast<size_t>(daqdataformats::FragmentErrorBits::kIncomplete);
+  constexpr auto not_found = 0x1 << static_cast<size_t>(daqdataformats::FragmentErrorBits::kDataNotFound);
+  switch (result_code) {
+    case ResultCode::kFound:
+      ++m_num_requests_found;
+      break;
+    case ResultCode::kTooOld:
+      frag_header.error_bits |= not_found;
+      ++m_num_requests_old_window;
+      ++m_num_requests_bad;
+      break;
+    case ResultCode::kPartiallyOld:
+      frag_header.error_bits |= incomplete | not_found;
+      ++m_num_requests_old_window;
+      ++m_num_requests_found;
+      break;
+    case ResultCode::kPartial:
+      frag_header.error_bits |= incomplete;
+      ++m_num_requests_delayed;
+      break;
+    case ResultCode::kNotYet:
+      frag_header.error_bits |= not_found;
+      ++m_num_requests_delayed;
+      break;
+    default:
+      frag_header.error_bits |= not_found;
+      ++m_num_requests_bad;
+  }
+}
+
+void
+HSIRequestHandler::generate_opmon_data()
+{
+  inherited::generate_opmon_data();
+
+  opmon::HSIRequestCacheInfo info;
+  info.set_requests(m_requests.load());
+  info.set_cache_hits(m_cache_hits.load());
+  info.set_cache_partial_hits(m_cache_partial_hits.load());
+  info.set_cache_misses(m_cache_misses.load());
+  info.set_pieces_found(m_pieces_found.load());
+  info.set_pieces_copied(m_pieces_copied.load());
+  publish(std::move(info));
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
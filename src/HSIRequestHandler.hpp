@@ -0,0 +1,112 @@
+/**
+ * @file HSIRequestHandler.hpp HSI specific request handler with a
+ * fragment-assembly cache for overlapping data requests
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSIREQUESTHANDLER_HPP_
+#define HSILIBS_SRC_HSIREQUESTHANDLER_HPP_
+
+#include "hsilibs/Types.hpp"
+#include "HSILatencyBuffer.hpp"
+
+#include "datahandlinglibs/models/DefaultRequestHandlerModel.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Merge fragment pieces that are adjacent in memory.
+ *
+ * Consecutive HSI frames sit next to each other in the latency buffer, so a
+ * window collapses into one piece (two when it wraps around the ring).
+ * Returns the number of pieces left.
+ */
+inline std::size_t
+coalesce_fragment_pieces(std::vector<std::pair<void*, size_t>>& pieces)
+{
+  if (pieces.size() < 2) {
+    return pieces.size();
+  }
+  std::size_t out = 0;
+  for (std::size_t i = 1; i < pieces.size(); ++i) {
+    auto& last = pieces[out];
+    if (static_cast<char*>(last.first) + last.second == static_cast<char*>(pieces[i].first)) {
+      last.second += pieces[i].second;
+    } else {
+      pieces[++out] = pieces[i];
+    }
+  }
+  pieces.resize(out + 1);
+  return pieces.size();
+}
+
+class HSIRequestHandler
+  : public datahandlinglibs::DefaultRequestHandlerModel<hsilibs::HSI_FRAME_STRUCT, hsilibs::HSILatencyBuffer>
+{
+public:
+  using latency_buffer_t = hsilibs::HSILatencyBuffer;
+  using inherited = datahandlinglibs::DefaultRequestHandlerModel<hsilibs::HSI_FRAME_STRUCT, latency_buffer_t>;
+  using timestamp_t = std::uint64_t; // NOLINT(build/unsigned)
+
+  explicit HSIRequestHandler(std::unique_ptr<latency_buffer_t>& latency_buffer,
+                             std::unique_ptr<datahandlinglibs::FrameErrorRegistry>& error_registry)
+    : inherited(latency_buffer, error_registry)
+  {}
+
+  void conf(const appmodel::DataHandlerModule* conf) override;
+  void start(const nlohmann::json& args) override;
+
+protected:
+  RequestResult data_request(dfmessages::DataRequest dr) override;
+
+  void generate_opmon_data() override;
+
+  // number of request windows kept; conf() takes it from HSIDataHandlerConf, standalone users set it directly
+  void set_cache_size(std::size_t cache_size) { m_cache_size = cache_size; }
+
+  std::atomic<uint64_t> m_requests{ 0 };           // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_cache_hits{ 0 };         // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_cache_partial_hits{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_cache_misses{ 0 };       // NOLINT(build/unsigned)
+
+private:
+  using frames_t = std::vector<hsilibs::HSI_FRAME_STRUCT>;
+
+  // Frames found for a fully available window
+  struct CacheEntry
+  {
+    timestamp_t window_begin;
+    timestamp_t window_end;
+    std::shared_ptr<const frames_t> frames;
+    uint64_t last_used; // NOLINT(build/unsigned)
+  };
+
+  // error bits of the fragment and the request counters of the base class for a result
+  void account_result(ResultCode result_code, daqdataformats::FragmentHeader& frag_header);
+
+  std::shared_ptr<const frames_t> cache_lookup(timestamp_t begin, timestamp_t& cached_end);
+  void cache_insert(timestamp_t begin, timestamp_t end, const std::vector<std::pair<void*, size_t>>& pieces);
+
+  std::size_t m_cache_size = 0;
+  std::vector<CacheEntry> m_cache;
+  std::mutex m_cache_mutex;
+  uint64_t m_cache_clock = 0; // NOLINT(build/unsigned)
+
+  std::atomic<uint64_t> m_pieces_found{ 0 };       // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_pieces_copied{ 0 };      // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSIREQUESTHANDLER_HPP_
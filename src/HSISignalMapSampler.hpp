@@ -0,0 +1,111 @@
+/**
+ * @file HSISignalMapSampler.hpp Sampling of 32-bit signal maps with
+ * independent, identically distributed signal bits
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSISIGNALMAPSAMPLER_HPP_
+#define HSILIBS_SRC_HSISIGNALMAPSAMPLER_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Draws signal maps in which each of the 32 bits is set independently
+ * with probability p.
+ *
+ * Rather than one Bernoulli trial per bit, the number of set bits is drawn
+ * from Binomial(32, p) by inverting a precomputed CDF, and the positions are
+ * then chosen with Floyd's subset sampling (on the cleared bits when more
+ * than half are set). Because every subset of a given size is equally likely
+ * for i.i.d. bits, this has exactly the per-bit statistics of the bitwise
+ * loop, for 1 + min(k, 32 - k) uniform draws instead of 32.
+ */
+class HSISignalMapSampler
+{
+public:
+  static constexpr unsigned s_num_signals = 32;
+
+  HSISignalMapSampler() { set_probability(0.); }
+  explicit HSISignalMapSampler(double p) { set_probability(p); }
+
+  /**
+   * @brief Probability that a bit fires when it is driven by a Poisson count
+   * with the given mean, i.e. P(N > 0) = 1 - exp(-mean)
+   */
+  static double probability_from_poisson_mean(double mean) { return mean > 0 ? -std::expm1(-mean) : 0.; }
+
+  void set_probability(double p)
+  {
+    p = p < 0 ? 0. : (p > 1 ? 1. : p);
+    m_probability = p;
+    // pmf(k) = C(32,k) p^k (1-p)^(32-k), built up in log space to stay finite at the tails
+    double cumulative = 0.;
+    for (unsigned k = 0; k <= s_num_signals; ++k) {
+      double pmf = 0.;
+      if (p == 0.) {
+        pmf = (k == 0) ? 1. : 0.;
+      } else if (p == 1.) {
+        pmf = (k == s_num_signals) ? 1. : 0.;
+      } else {
+        double log_choose =
+          std::lgamma(s_num_signals + 1.) - std::lgamma(k + 1.) - std::lgamma(s_num_signals - k + 1.);
+        pmf = std::exp(log_choose + k * std::log(p) + (s_num_signals - k) * std::log1p(-p));
+      }
+      cumulative += pmf;
+      m_cdf[k] = cumulative;
+    }
+    m_cdf[s_num_signals] = 1.;
+  }
+
+  double probability() const { return m_probability; }
+
+  template<class URBG>
+  uint32_t operator()(URBG& generator) // NOLINT(build/unsigned)
+  {
+    if (m_cdf[0] >= 1.) {
+      return 0;
+    }
+    double u = m_uniform(generator);
+    unsigned k = 0;
+    while (k < s_num_signals && u >= m_cdf[k]) {
+      ++k;
+    }
+    if (k == s_num_signals) {
+      return UINT32_MAX;
+    }
+    bool invert = k > s_num_signals / 2;
+    uint32_t mask = choose(invert ? s_num_signals - k : k, generator); // NOLINT(build/unsigned)
+    return invert ? ~mask : mask;
+  }
+
+private:
+  // Floyd's algorithm: a uniformly random k-subset of [0, 32) with k draws
+  template<class URBG>
+  static uint32_t choose(unsigned k, URBG& generator) // NOLINT(build/unsigned)
+  {
+    uint32_t mask = 0; // NOLINT(build/unsigned)
+    for (unsigned j = s_num_signals - k; j < s_num_signals; ++j) {
+      auto t = std::uniform_int_distribution<unsigned>(0, j)(generator);
+      uint32_t bit = 1U << t; // NOLINT(build/unsigned)
+      mask |= (mask & bit) ? (1U << j) : bit;
+    }
+    return mask;
+  }
+
+  double m_probability = 0.;
+  std::array<double, s_num_signals + 1> m_cdf;
+  std::uniform_real_distribution<double> m_uniform{ 0., 1. };
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSISIGNALMAPSAMPLER_HPP_
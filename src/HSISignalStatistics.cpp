@@ -0,0 +1,73 @@
+/**
+ * @file HSISignalStatistics.cpp Per-signal-bit statistics of the HSI frame stream
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSISignalStatistics.hpp"
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSISignalStatistics::reset()
+{
+  std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+  m_frames.store(0);
+  m_empty_frames.store(0);
+  m_signals.store(0);
+  for (auto& signal : m_per_signal) {
+    signal.count.store(0);
+    signal.last_seen.store(0);
+    signal.intervals.reset();
+  }
+  m_last_snapshot_time = std::chrono::steady_clock::now();
+  m_last_frames = 0;
+  m_last_counts.fill(0);
+}
+
+HSISignalStatistics::Snapshot
+HSISignalStatistics::snapshot()
+{
+  Snapshot snap;
+
+  std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - m_last_snapshot_time).count();
+  m_last_snapshot_time = now;
+
+  snap.frames = m_frames.load(std::memory_order_relaxed);
+  snap.empty_frames = m_empty_frames.load(std::memory_order_relaxed);
+  snap.signals = m_signals.load(std::memory_order_relaxed);
+  auto non_empty = snap.frames - snap.empty_frames;
+  snap.mean_multiplicity = non_empty ? static_cast<double>(snap.signals) / non_empty : 0.;
+  if (elapsed > 0.) {
+    snap.frame_rate_hz = (snap.frames - m_last_frames) / elapsed;
+  }
+  m_last_frames = snap.frames;
+
+  for (std::size_t i = 0; i < s_num_signals; ++i) {
+    auto& signal = m_per_signal[i];
+    auto& out = snap.per_signal[i];
+    out.count = signal.count.load(std::memory_order_relaxed);
+    if (out.count == 0) {
+      continue;
+    }
+    snap.fired_mask |= (1U << i);
+    if (elapsed > 0.) {
+      out.rate_hz = (out.count - m_last_counts[i]) / elapsed;
+    }
+    m_last_counts[i] = out.count;
+    out.last_seen_timestamp = signal.last_seen.load(std::memory_order_relaxed);
+    out.mean_interval_ticks = signal.intervals.mean();
+    out.min_interval_ticks = signal.intervals.min();
+    out.max_interval_ticks = signal.intervals.max();
+    out.p50_interval_ticks = signal.intervals.quantile(0.5);
+    out.p99_interval_ticks = signal.intervals.quantile(0.99);
+  }
+  return snap;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
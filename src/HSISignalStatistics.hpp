@@ -0,0 +1,122 @@
+/**
+ * @file HSISignalStatistics.hpp Per-signal-bit statistics of the HSI frame stream
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSISIGNALSTATISTICS_HPP_
+#define HSILIBS_SRC_HSISIGNALSTATISTICS_HPP_
+
+#include "LogHistogram.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Counters, last-seen timestamps and inter-arrival histograms for
+ * each of the 32 HSI signal bits.
+ *
+ * add() is called from a single thread (the processor's post-processing
+ * thread); snapshots may be taken concurrently from the opmon thread, and
+ * reset() from the command thread while no frames are added.
+ */
+class HSISignalStatistics
+{
+public:
+  static constexpr std::size_t s_num_signals = 32;
+  using timestamp_t = std::uint64_t; // NOLINT(build/unsigned)
+  using histogram_t = LogHistogram<48>;
+
+  struct SignalSnapshot
+  {
+    uint64_t count = 0;            // NOLINT(build/unsigned)
+    double rate_hz = 0.;
+    timestamp_t last_seen_timestamp = 0;
+    double mean_interval_ticks = 0.;
+    uint64_t min_interval_ticks = 0; // NOLINT(build/unsigned)
+    uint64_t max_interval_ticks = 0; // NOLINT(build/unsigned)
+    double p50_interval_ticks = 0.;
+    double p99_interval_ticks = 0.;
+  };
+
+  struct Snapshot
+  {
+    uint64_t frames = 0;       // NOLINT(build/unsigned)
+    double frame_rate_hz = 0.;
+    uint64_t signals = 0;      // NOLINT(build/unsigned)
+    uint64_t empty_frames = 0; // NOLINT(build/unsigned)
+    double mean_multiplicity = 0.;
+    uint32_t fired_mask = 0;   // NOLINT(build/unsigned)
+    std::array<SignalSnapshot, s_num_signals> per_signal;
+  };
+
+  HSISignalStatistics() { reset(); }
+
+  void reset();
+
+  /**
+   * @brief Account for one frame's trigger bits. Hot path.
+   */
+  void add(timestamp_t timestamp, uint32_t signal_map) // NOLINT(build/unsigned)
+  {
+    bump(m_frames);
+    if (signal_map == 0) {
+      bump(m_empty_frames);
+      return;
+    }
+    bump(m_signals, __builtin_popcount(signal_map));
+    // visit only the set bits
+    for (uint32_t bits = signal_map; bits; bits &= bits - 1) { // NOLINT(build/unsigned)
+      auto bit = __builtin_ctz(bits);
+      auto& signal = m_per_signal[bit];
+      auto last = signal.last_seen.load(std::memory_order_relaxed);
+      if (last != 0 && timestamp > last) {
+        signal.intervals.fill(timestamp - last);
+      }
+      signal.last_seen.store(timestamp, std::memory_order_relaxed);
+      bump(signal.count);
+    }
+  }
+
+  /**
+   * @brief Take a snapshot; rates are computed over the time elapsed since
+   * the previous call or reset().
+   */
+  Snapshot snapshot();
+
+private:
+  static void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) // NOLINT(build/unsigned)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  struct PerSignal
+  {
+    std::atomic<uint64_t> count;        // NOLINT(build/unsigned)
+    std::atomic<timestamp_t> last_seen;
+    histogram_t intervals;
+  };
+
+  std::atomic<uint64_t> m_frames;       // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_empty_frames; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_signals;      // NOLINT(build/unsigned)
+  std::array<PerSignal, s_num_signals> m_per_signal;
+
+  // rate bookkeeping, shared by snapshot() and reset()
+  std::mutex m_snapshot_mutex;
+  std::chrono::steady_clock::time_point m_last_snapshot_time;
+  uint64_t m_last_frames;                                         // NOLINT(build/unsigned)
+  std::array<uint64_t, s_num_signals> m_last_counts;              // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSISIGNALSTATISTICS_HPP_
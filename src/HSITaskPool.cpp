@@ -0,0 +1,125 @@
+/**
+ * @file HSITaskPool.cpp Worker pool for HSI frame processing tasks
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSITaskPool.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSITaskPool::start(std::size_t n_workers, std::size_t queue_size, const std::string& thread_name)
+{
+  stop();
+  if (n_workers == 0 || m_tasks.empty()) {
+    return;
+  }
+
+  // a task is pinned to a single worker, more workers than tasks would stay idle
+  n_workers = std::min(n_workers, std::min<std::size_t>(m_tasks.size(), 64));
+
+  std::lock_guard<std::mutex> lock(m_workers_mutex);
+  for (std::size_t i = 0; i < n_workers; ++i) {
+    // folly's queue keeps one slot free
+    m_workers.push_back(std::make_unique<Worker>(queue_size + 1));
+  }
+  m_num_workers = n_workers;
+  for (std::size_t i = 0; i < m_tasks.size() && i < 64; ++i) {
+    m_workers[i % n_workers]->pinned_mask |= (1ULL << i);
+  }
+
+  m_dropped = 0;
+  m_blocked = 0;
+  m_running = true;
+  for (std::size_t i = 0; i < n_workers; ++i) {
+    auto& worker = *m_workers[i];
+    worker.thread = std::thread(&HSITaskPool::run_worker, this, std::ref(worker));
+    auto name = thread_name + "-" + std::to_string(i);
+    pthread_setname_np(worker.thread.native_handle(), name.substr(0, 15).c_str());
+  }
+  TLOG_DEBUG(2) << "Started " << n_workers << " HSI processing workers for " << m_tasks.size() << " tasks";
+}
+
+void
+HSITaskPool::stop()
+{
+  m_running = false;
+  std::lock_guard<std::mutex> lock(m_workers_mutex);
+  for (auto& worker : m_workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  m_workers.clear();
+  m_num_workers = 0;
+}
+
+bool
+HSITaskPool::dispatch(const HSI_FRAME_STRUCT& frame)
+{
+  if (m_workers.empty()) {
+    return false;
+  }
+
+  bool waited = false;
+  for (auto& worker_ptr : m_workers) {
+    auto& worker = *worker_ptr;
+    uint64_t mask = worker.pinned_mask; // NOLINT(build/unsigned)
+    // the tasks need every frame (sequence checks, raw capture): hold the producer until the worker catches up
+    while (!worker.queue.write(Item{ frame, mask })) {
+      if (!m_running.load(std::memory_order_relaxed)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        break;
+      }
+      if (!waited) {
+        waited = true;
+        m_blocked.fetch_add(1, std::memory_order_relaxed);
+      }
+      std::this_thread::yield();
+    }
+  }
+  return waited;
+}
+
+std::size_t
+HSITaskPool::occupancy() const
+{
+  std::lock_guard<std::mutex> lock(m_workers_mutex);
+  std::size_t total = 0;
+  for (auto& worker : m_workers) {
+    total += worker->queue.sizeGuess();
+  }
+  return total;
+}
+
+void
+HSITaskPool::run_worker(Worker& worker)
+{
+  Item item;
+  while (true) {
+    if (worker.queue.read(item)) {
+      for (uint64_t bits = item.task_mask; bits; bits &= bits - 1) { // NOLINT(build/unsigned)
+        (*m_tasks[__builtin_ctzll(bits)])(&item.frame);
+      }
+    } else if (m_running.load(std::memory_order_relaxed)) {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    } else {
+      // drained after stop
+      break;
+    }
+  }
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
@@ -0,0 +1,149 @@
+/**
+ * @file HSITaskPool.hpp Worker pool for HSI frame processing tasks
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITASKPOOL_HPP_
+#define HSILIBS_SRC_HSITASKPOOL_HPP_
+
+#include "hsilibs/Types.hpp"
+
+#include "folly/ProducerConsumerQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief A named frame processing task with its own timing counters.
+ *
+ * Tasks see frames strictly in arrival order: the HSI tasks (sequence gap
+ * detection, raw capture, inter-arrival statistics) all depend on it.
+ */
+class HSIProcessingTask
+{
+public:
+  using function_t = std::function<void(const HSI_FRAME_STRUCT*)>;
+
+  HSIProcessingTask(std::string name, function_t function)
+    : m_name(std::move(name))
+    , m_function(std::move(function))
+  {}
+
+  void operator()(const HSI_FRAME_STRUCT* frame)
+  {
+    auto start = std::chrono::steady_clock::now();
+    m_function(frame);
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( // NOLINT(build/unsigned)
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    m_calls.fetch_add(1, std::memory_order_relaxed);
+    m_total_ns.fetch_add(elapsed, std::memory_order_relaxed);
+    auto max = m_max_ns.load(std::memory_order_relaxed);
+    while (elapsed > max && !m_max_ns.compare_exchange_weak(max, elapsed, std::memory_order_relaxed)) {
+    }
+  }
+
+  void reset_timing()
+  {
+    m_calls = 0;
+    m_total_ns = 0;
+    m_max_ns = 0;
+  }
+
+  const std::string& name() const { return m_name; }
+  uint64_t calls() const { return m_calls.load(std::memory_order_relaxed); }       // NOLINT(build/unsigned)
+  uint64_t total_ns() const { return m_total_ns.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t max_ns() const { return m_max_ns.load(std::memory_order_relaxed); }     // NOLINT(build/unsigned)
+
+private:
+  std::string m_name;
+  function_t m_function;
+  std::atomic<uint64_t> m_calls{ 0 };    // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_total_ns{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max_ns{ 0 };   // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Small pool of worker threads running HSIProcessingTasks on copies
+ * of the ingested frames.
+ *
+ * Task i is pinned to worker (i % n_workers), which preserves the frame
+ * order it sees. A task never spans workers, so the pool runs at most one
+ * worker per task; start() does not create more. dispatch() must be called from a single producer thread; it waits for
+ * room in a full worker queue, so no frame is lost while the pool runs.
+ */
+class HSITaskPool
+{
+public:
+  HSITaskPool() = default;
+  ~HSITaskPool() { stop(); }
+
+  HSITaskPool(const HSITaskPool&) = delete;
+  HSITaskPool& operator=(const HSITaskPool&) = delete;
+
+  void set_tasks(std::vector<HSIProcessingTask*> tasks) { m_tasks = std::move(tasks); }
+
+  void start(std::size_t n_workers, std::size_t queue_size, const std::string& thread_name);
+
+  /**
+   * @brief Stop the workers after they have drained their queues
+   */
+  void stop();
+
+  /**
+   * @brief Queue a frame copy for the workers; returns true if it had to wait for a full queue
+   */
+  bool dispatch(const HSI_FRAME_STRUCT& frame);
+
+  bool running() const { return m_running.load(); }
+  std::size_t num_workers() const { return m_num_workers.load(std::memory_order_relaxed); }
+  // frames dispatched while the pool was stopping, which no task saw
+  uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t blocked() const { return m_blocked.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  // safe to call from any thread, also while the pool is being started or stopped
+  std::size_t occupancy() const;
+
+private:
+  struct Item
+  {
+    HSI_FRAME_STRUCT frame;
+    uint64_t task_mask; // NOLINT(build/unsigned)
+  };
+
+  struct Worker
+  {
+    explicit Worker(std::size_t queue_size)
+      : queue(queue_size)
+    {}
+    folly::ProducerConsumerQueue<Item> queue;
+    uint64_t pinned_mask = 0; // NOLINT(build/unsigned)
+    std::thread thread;
+  };
+
+  void run_worker(Worker& worker);
+
+  std::vector<HSIProcessingTask*> m_tasks;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  mutable std::mutex m_workers_mutex; // guards m_workers against readers outside the data path
+  std::atomic<std::size_t> m_num_workers{ 0 };
+  std::atomic<bool> m_running{ false };
+  std::atomic<uint64_t> m_dropped{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_blocked{ 0 }; // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITASKPOOL_HPP_
@@ -0,0 +1,140 @@
+/**
+ * @file HSIThreadTuning.cpp CPU affinity and scheduling settings for HSI worker threads
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSIThreadTuning.hpp"
+#include "HSITraceRing.hpp"
+
+#include "hsilibs/Issues.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+HSIThreadSettings
+HSIThreadSettings::from_conf(const dal::HSIThreadConf* conf)
+{
+  HSIThreadSettings settings;
+  if (conf == nullptr) {
+    return settings;
+  }
+  try {
+    settings.cpus = parse_cpu_list(conf->get_cpu_set());
+  } catch (const std::invalid_argument& excpt) {
+    ers::warning(HSIThreadTuningIssue(ERS_HERE, conf->UID(), excpt.what()));
+  }
+  if (conf->get_scheduling_policy() == "fifo") {
+    settings.policy = Policy::kFifo;
+  } else if (conf->get_scheduling_policy() == "rr") {
+    settings.policy = Policy::kRoundRobin;
+  }
+  settings.priority = conf->get_priority();
+  settings.busy_poll = conf->get_busy_poll();
+  settings.trace_ring_size = conf->get_trace_ring_size();
+  settings.trace_dump_directory = conf->get_trace_dump_directory();
+  return settings;
+}
+
+std::vector<int>
+parse_cpu_list(const std::string& list)
+{
+  std::vector<int> cpus;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+    if (item.empty()) {
+      continue;
+    }
+    try {
+      auto dash = item.find('-');
+      auto first_part = item.substr(0, dash);
+      auto last_part = dash == std::string::npos ? first_part : item.substr(dash + 1);
+      std::size_t first_used = 0;
+      std::size_t last_used = 0;
+      int first = std::stoi(first_part, &first_used);
+      int last = std::stoi(last_part, &last_used);
+      if (first_used != first_part.size() || last_used != last_part.size()) {
+        throw std::invalid_argument(item);
+      }
+      if (first < 0 || last < first || last >= CPU_SETSIZE) {
+        throw std::invalid_argument(item);
+      }
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::logic_error&) {
+      throw std::invalid_argument("malformed cpu_set entry '" + item + "'");
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+void
+apply_thread_settings(const std::string& thread_name, const HSIThreadSettings& settings)
+{
+  std::ostringstream applied;
+
+  if (!settings.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : settings.cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if (rc != 0) {
+      ers::warning(HSIThreadTuningIssue(ERS_HERE, thread_name, std::string("setting cpu affinity: ") + std::strerror(rc)));
+    } else {
+      applied << " cpus:";
+      for (auto cpu : settings.cpus) {
+        applied << " " << cpu;
+      }
+    }
+  }
+
+  if (settings.policy != HSIThreadSettings::Policy::kOther) {
+    int policy = settings.policy == HSIThreadSettings::Policy::kFifo ? SCHED_FIFO : SCHED_RR;
+    sched_param param{};
+    param.sched_priority =
+      std::clamp(settings.priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+    int rc = pthread_setschedparam(pthread_self(), policy, &param);
+    if (rc != 0) {
+      // typically EPERM without CAP_SYS_NICE or an rtprio limit
+      ers::warning(HSIThreadTuningIssue(ERS_HERE, thread_name, std::string("setting real-time scheduling: ") + std::strerror(rc)));
+    } else {
+      applied << " policy: " << (policy == SCHED_FIFO ? "fifo" : "rr") << " priority: " << param.sched_priority;
+    }
+  }
+
+  if (settings.busy_poll) {
+    applied << " busy poll";
+  }
+
+  HSITraceRegistry::get().attach_current_thread(thread_name, settings.trace_ring_size);
+  if (settings.trace_ring_size > 0) {
+    applied << " trace ring: " << settings.trace_ring_size << " records";
+  }
+
+  if (!applied.str().empty()) {
+    TLOG() << "Thread " << thread_name << " tuned;" << applied.str();
+  }
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
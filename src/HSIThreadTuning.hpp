@@ -0,0 +1,69 @@
+/**
+ * @file HSIThreadTuning.hpp CPU affinity and scheduling settings for HSI worker threads
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITHREADTUNING_HPP_
+#define HSILIBS_SRC_HSITHREADTUNING_HPP_
+
+#include "hsilibs/dal/HSIThreadConf.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief What an HSIThreadConf asks for, in a form the thread itself can apply.
+ *
+ * The settings are applied from inside the worker thread at the top of its
+ * work function, since WorkerThread does not expose the native handle.
+ */
+struct HSIThreadSettings
+{
+  enum class Policy
+  {
+    kOther,
+    kFifo,
+    kRoundRobin
+  };
+
+  std::vector<int> cpus; // empty leaves the affinity alone
+  Policy policy = Policy::kOther;
+  int priority = 0;
+  bool busy_poll = false;
+  std::size_t trace_ring_size = 0; // records; 0 leaves the thread without a trace ring
+  std::string trace_dump_directory = ".";
+
+  // defaults when conf is null; a malformed cpu_set is reported and ignored
+  static HSIThreadSettings from_conf(const dal::HSIThreadConf* conf);
+};
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}; throws std::invalid_argument on malformed input
+std::vector<int>
+parse_cpu_list(const std::string& list);
+
+// apply to the calling thread, log what was applied and warn about anything that was refused;
+// also attaches the trace ring of the thread, named after it
+void
+apply_thread_settings(const std::string& thread_name, const HSIThreadSettings& settings);
+
+// spin-wait hint for busy-poll loops
+inline void
+cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITHREADTUNING_HPP_
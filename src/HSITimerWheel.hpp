@@ -0,0 +1,98 @@
+/**
+ * @file HSITimerWheel.hpp Hashed timing wheel for scheduling many periodic
+ * sources from one thread
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITIMERWHEEL_HPP_
+#define HSILIBS_SRC_HSITIMERWHEEL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Hashed timing wheel: items are bucketed by due time modulo
+ * num_slots * resolution, so scheduling is O(1) and advancing only visits
+ * the slots that have elapsed. Items due more than one revolution ahead stay
+ * in their slot until their time comes round. Times are in arbitrary integer
+ * units (the generator uses ns since the start of the run).
+ *
+ * Not thread safe.
+ */
+template<class T>
+class HSITimerWheel
+{
+public:
+  HSITimerWheel(std::size_t num_slots, uint64_t resolution) // NOLINT(build/unsigned)
+    : m_slots(std::max<std::size_t>(num_slots, 1))
+    , m_resolution(std::max<uint64_t>(resolution, 1)) // NOLINT(build/unsigned)
+  {}
+
+  void clear()
+  {
+    for (auto& slot : m_slots) {
+      slot.clear();
+    }
+    m_current_tick = 0;
+    m_size = 0;
+  }
+
+  std::size_t size() const { return m_size; }
+
+  void schedule(uint64_t due, T item) // NOLINT(build/unsigned)
+  {
+    // overdue items go in the current slot and are picked up by the next advance()
+    auto tick = std::max(due / m_resolution, m_current_tick);
+    m_slots[tick % m_slots.size()].push_back(Entry{ due, std::move(item) });
+    ++m_size;
+  }
+
+  /**
+   * @brief Hand every item due at or before now to fn(due, item) and remove it
+   */
+  template<class F>
+  void advance(uint64_t now, F&& fn) // NOLINT(build/unsigned)
+  {
+    auto target = now / m_resolution;
+    auto n_ticks = std::min<uint64_t>(target - std::min(target, m_current_tick) + 1, m_slots.size()); // NOLINT(build/unsigned)
+    for (uint64_t i = 0; i < n_ticks; ++i) { // NOLINT(build/unsigned)
+      auto& slot = m_slots[(m_current_tick + i) % m_slots.size()];
+      for (std::size_t j = 0; j < slot.size();) {
+        if (slot[j].due <= now) {
+          fn(slot[j].due, std::move(slot[j].item));
+          slot[j] = std::move(slot.back());
+          slot.pop_back();
+          --m_size;
+        } else {
+          ++j;
+        }
+      }
+    }
+    m_current_tick = std::max(m_current_tick, target);
+  }
+
+private:
+  struct Entry
+  {
+    uint64_t due; // NOLINT(build/unsigned)
+    T item;
+  };
+
+  std::vector<std::vector<Entry>> m_slots;
+  uint64_t m_resolution;       // NOLINT(build/unsigned)
+  uint64_t m_current_tick = 0; // NOLINT(build/unsigned)
+  std::size_t m_size = 0;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITIMERWHEEL_HPP_
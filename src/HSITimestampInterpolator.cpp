@@ -0,0 +1,81 @@
+/**
+ * @file HSITimestampInterpolator.cpp Per-event timestamps interpolated from
+ * periodic anchors taken from a TimestampEstimator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSITimestampInterpolator.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace dunedaq {
+namespace hsilibs {
+
+namespace {
+// fraction of the measured rate difference applied per re-anchor
+constexpr double s_rate_gain = 0.1;
+constexpr double s_max_rate_deviation = 0.01;
+}
+
+void
+HSITimestampInterpolator::configure(uint64_t clock_frequency_hz, std::chrono::microseconds reanchor_period) // NOLINT(build/unsigned)
+{
+  m_nominal_ticks_per_second = clock_frequency_hz;
+  m_reanchor_period = std::max<std::chrono::steady_clock::duration>(reanchor_period, std::chrono::microseconds(1));
+  reset(m_estimator);
+}
+
+void
+HSITimestampInterpolator::reset(const utilities::TimestampEstimatorBase* estimator)
+{
+  m_estimator = estimator;
+  m_ticks_per_second = m_nominal_ticks_per_second;
+  m_anchor_timestamp = 0;
+  m_last_timestamp = 0;
+  m_last_error.store(0, std::memory_order_relaxed);
+  m_max_abs_error.store(0, std::memory_order_relaxed);
+  m_anchors.store(0, std::memory_order_relaxed);
+  // anchor on the first call
+  m_next_anchor_time = std::chrono::steady_clock::time_point::min();
+}
+
+void
+HSITimestampInterpolator::reanchor(std::chrono::steady_clock::time_point now)
+{
+  if (m_estimator == nullptr) {
+    m_next_anchor_time = std::chrono::steady_clock::time_point::max();
+    return;
+  }
+  timestamp_t estimate = m_estimator->get_timestamp_estimate();
+
+  if (m_anchors.load(std::memory_order_relaxed) > 0) {
+    double dt = std::chrono::duration<double>(now - m_anchor_time).count();
+    auto predicted = m_anchor_timestamp + static_cast<timestamp_t>(dt * m_ticks_per_second);
+    int64_t error = static_cast<int64_t>(predicted - estimate);
+    m_last_error.store(error, std::memory_order_relaxed);
+    uint64_t abs_error = std::abs(error); // NOLINT(build/unsigned)
+    if (abs_error > m_max_abs_error.load(std::memory_order_relaxed)) {
+      m_max_abs_error.store(abs_error, std::memory_order_relaxed);
+    }
+
+    // drift correction towards the rate the estimator actually advanced at
+    if (dt > 0 && estimate > m_anchor_timestamp) {
+      double measured = (estimate - m_anchor_timestamp) / dt;
+      m_ticks_per_second += s_rate_gain * (measured - m_ticks_per_second);
+      m_ticks_per_second = std::clamp(m_ticks_per_second,
+                                      m_nominal_ticks_per_second * (1 - s_max_rate_deviation),
+                                      m_nominal_ticks_per_second * (1 + s_max_rate_deviation));
+    }
+  }
+
+  m_anchor_time = now;
+  m_anchor_timestamp = estimate;
+  m_next_anchor_time = now + m_reanchor_period;
+  m_anchors.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
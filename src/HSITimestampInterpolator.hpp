@@ -0,0 +1,85 @@
+/**
+ * @file HSITimestampInterpolator.hpp Per-event timestamps interpolated from
+ * periodic anchors taken from a TimestampEstimator
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITIMESTAMPINTERPOLATOR_HPP_
+#define HSILIBS_SRC_HSITIMESTAMPINTERPOLATOR_HPP_
+
+#include "utilities/TimestampEstimatorBase.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Extrapolates timestamps from the last anchor with the local steady
+ * clock, so the shared estimator is only consulted once per reanchor period.
+ *
+ * At each re-anchor the extrapolated timestamp is compared with the
+ * estimator. The difference is recorded as the interpolation error, and the
+ * tick rate is nudged towards the rate the estimator advanced at, within
+ * 1% of nominal. Returned timestamps never go backwards.
+ *
+ * get_timestamp() must be called from one thread; the error counters can be
+ * read from any thread.
+ */
+class HSITimestampInterpolator
+{
+public:
+  using timestamp_t = uint64_t; // NOLINT(build/unsigned)
+
+  void configure(uint64_t clock_frequency_hz, std::chrono::microseconds reanchor_period); // NOLINT(build/unsigned)
+
+  /**
+   * @brief Start interpolating against estimator (not owned); nullptr disables
+   */
+  void reset(const utilities::TimestampEstimatorBase* estimator);
+
+  timestamp_t get_timestamp()
+  {
+    auto now = std::chrono::steady_clock::now();
+    if (now >= m_next_anchor_time) {
+      reanchor(now);
+    }
+    double dt = std::chrono::duration<double>(now - m_anchor_time).count();
+    timestamp_t ts = m_anchor_timestamp + static_cast<timestamp_t>(dt * m_ticks_per_second);
+    if (ts < m_last_timestamp) {
+      ts = m_last_timestamp;
+    }
+    m_last_timestamp = ts;
+    return ts;
+  }
+
+  int64_t last_error() const { return m_last_error.load(std::memory_order_relaxed); }
+  uint64_t max_abs_error() const { return m_max_abs_error.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t anchors() const { return m_anchors.load(std::memory_order_relaxed); }             // NOLINT(build/unsigned)
+
+private:
+  void reanchor(std::chrono::steady_clock::time_point now);
+
+  const utilities::TimestampEstimatorBase* m_estimator = nullptr;
+  double m_nominal_ticks_per_second = 62.5e6;
+  double m_ticks_per_second = 62.5e6;
+  std::chrono::steady_clock::duration m_reanchor_period = std::chrono::milliseconds(10);
+
+  std::chrono::steady_clock::time_point m_anchor_time;
+  std::chrono::steady_clock::time_point m_next_anchor_time;
+  timestamp_t m_anchor_timestamp = 0;
+  timestamp_t m_last_timestamp = 0;
+
+  std::atomic<int64_t> m_last_error{ 0 };
+  std::atomic<uint64_t> m_max_abs_error{ 0 }; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_anchors{ 0 };       // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITIMESTAMPINTERPOLATOR_HPP_
@@ -0,0 +1,147 @@
+/**
+ * @file HSITraceReader.cpp Memory-mapped reader of recorded HSI traces
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSITraceReader.hpp"
+
+#include "hsilibs/Issues.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+void
+HSITraceReader::open(const std::string& path)
+{
+  close();
+  m_path = path;
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw HSITraceIssue(ERS_HERE, path, std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(uint64_t)) { // NOLINT(build/unsigned)
+    ::close(fd);
+    throw HSITraceIssue(ERS_HERE, path, "file too short");
+  }
+  m_file_size = st.st_size;
+  void* mapping = ::mmap(nullptr, m_file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    throw HSITraceIssue(ERS_HERE, path, std::string("mmap failed: ") + std::strerror(errno));
+  }
+  ::madvise(mapping, m_file_size, MADV_SEQUENTIAL);
+  m_data = static_cast<const unsigned char*>(mapping);
+
+  uint64_t magic = 0; // NOLINT(build/unsigned)
+  std::memcpy(&magic, m_data, sizeof(magic));
+
+  if (magic == HSICaptureFileHeader::s_magic && m_file_size >= sizeof(HSICaptureFileHeader)) {
+    HSICaptureFileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (header.frame_size != sizeof(HSI_FRAME_STRUCT) || header.frames_per_block == 0 ||
+        header.block_size < header.frames_per_block * sizeof(HSI_FRAME_STRUCT)) {
+      close();
+      throw HSITraceIssue(ERS_HERE, path, "inconsistent capture file header");
+    }
+    m_is_capture = true;
+    m_header_size = header.header_size;
+    m_block_size = header.block_size;
+    m_frames_per_block = header.frames_per_block;
+    m_clock_frequency_hz = header.clock_frequency_hz;
+
+    // full blocks, then the frames of the truncated last block
+    std::size_t data_size = m_file_size > m_header_size ? m_file_size - m_header_size : 0;
+    std::size_t full_blocks = data_size / m_block_size;
+    std::size_t tail_frames = std::min((data_size % m_block_size) / sizeof(HSI_FRAME_STRUCT), m_frames_per_block);
+    m_num_entries = full_blocks * m_frames_per_block + tail_frames;
+  } else if (magic == HSITraceFileHeader::s_magic && m_file_size >= sizeof(HSITraceFileHeader)) {
+    HSITraceFileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (header.record_size != sizeof(HSITraceRecord)) {
+      close();
+      throw HSITraceIssue(ERS_HERE, path, "unsupported trace record size " + std::to_string(header.record_size));
+    }
+    m_is_capture = false;
+    m_clock_frequency_hz = header.clock_frequency_hz;
+    std::size_t available = (m_file_size - sizeof(HSITraceFileHeader)) / sizeof(HSITraceRecord);
+    m_num_entries = std::min<std::size_t>(header.num_records, available);
+  } else {
+    close();
+    throw HSITraceIssue(ERS_HERE, path, "neither an HSI trace nor an HSI capture file");
+  }
+
+  rewind();
+}
+
+void
+HSITraceReader::close()
+{
+  if (m_data != nullptr) {
+    ::munmap(const_cast<unsigned char*>(m_data), m_file_size);
+  }
+  m_data = nullptr;
+  m_file_size = 0;
+  m_num_entries = 0;
+  m_position = 0;
+}
+
+void
+HSITraceReader::rewind()
+{
+  m_position = 0;
+  m_previous_timestamp = 0;
+}
+
+const HSI_FRAME_STRUCT*
+HSITraceReader::capture_frame(std::size_t index) const
+{
+  auto offset = m_header_size + (index / m_frames_per_block) * m_block_size +
+                (index % m_frames_per_block) * sizeof(HSI_FRAME_STRUCT);
+  return reinterpret_cast<const HSI_FRAME_STRUCT*>(m_data + offset);
+}
+
+bool
+HSITraceReader::next(Entry& entry)
+{
+  if (!m_is_capture) {
+    if (m_position >= m_num_entries) {
+      return false;
+    }
+    HSITraceRecord record;
+    std::memcpy(&record, m_data + sizeof(HSITraceFileHeader) + m_position * sizeof(HSITraceRecord), sizeof(record));
+    ++m_position;
+    entry.delta_ticks = record.delta_ticks;
+    entry.signal_map = record.signal_map;
+    return true;
+  }
+
+  while (m_position < m_num_entries) {
+    HSI_FRAME_STRUCT frame;
+    std::memcpy(&frame, capture_frame(m_position++), sizeof(frame));
+    auto ts = frame.get_timestamp();
+    if (ts == 0) {
+      continue;
+    }
+    entry.delta_ticks = (m_previous_timestamp != 0 && ts > m_previous_timestamp) ? ts - m_previous_timestamp : 0;
+    entry.signal_map = frame.frame.input_low;
+    m_previous_timestamp = ts;
+    return true;
+  }
+  return false;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
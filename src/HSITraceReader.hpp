@@ -0,0 +1,106 @@
+/**
+ * @file HSITraceReader.hpp Memory-mapped reader of recorded HSI traces
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITRACEREADER_HPP_
+#define HSILIBS_SRC_HSITRACEREADER_HPP_
+
+#include "HSICaptureWriter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Header of a compact trace file. It is followed by num_records
+ * HSITraceRecords.
+ */
+struct HSITraceFileHeader
+{
+  static constexpr uint64_t s_magic = 0x3130435254495348; // "HSITRC01" NOLINT(build/unsigned)
+  static constexpr uint32_t s_version = 1;                // NOLINT(build/unsigned)
+
+  uint64_t magic = s_magic;        // NOLINT(build/unsigned)
+  uint32_t version = s_version;    // NOLINT(build/unsigned)
+  uint32_t record_size = 16;       // NOLINT(build/unsigned)
+  uint64_t num_records = 0;        // NOLINT(build/unsigned)
+  uint64_t clock_frequency_hz = 0; // NOLINT(build/unsigned)
+};
+
+struct HSITraceRecord
+{
+  uint64_t delta_ticks = 0; // NOLINT(build/unsigned) ticks since the previous record
+  uint32_t signal_map = 0;  // NOLINT(build/unsigned)
+  uint32_t reserved = 0;    // NOLINT(build/unsigned)
+};
+
+/**
+ * @brief Sequential reader of timestamp deltas and signal maps, from either
+ * a compact trace file or a raw capture written by HSICaptureWriter.
+ *
+ * The file is memory-mapped read-only, so reading an entry costs no system
+ * call. For capture files the deltas come from consecutive frame timestamps
+ * and the signal map from the frame's low input word. Zeroed frames, such as
+ * those left by a failed block write, are skipped.
+ */
+class HSITraceReader
+{
+public:
+  struct Entry
+  {
+    uint64_t delta_ticks = 0; // NOLINT(build/unsigned)
+    uint32_t signal_map = 0;  // NOLINT(build/unsigned)
+  };
+
+  HSITraceReader() = default;
+  ~HSITraceReader() { close(); }
+
+  HSITraceReader(const HSITraceReader&) = delete;            ///< HSITraceReader is not copy-constructible
+  HSITraceReader& operator=(const HSITraceReader&) = delete; ///< HSITraceReader is not copy-assignable
+
+  /**
+   * @brief Map the file and detect its format; throws HSITraceIssue
+   */
+  void open(const std::string& path);
+  void close();
+
+  /**
+   * @brief Next entry; false at the end of the trace
+   */
+  bool next(Entry& entry);
+  void rewind();
+
+  bool is_open() const { return m_data != nullptr; }
+  std::size_t size() const { return m_num_entries; }
+  uint64_t clock_frequency_hz() const { return m_clock_frequency_hz; } // NOLINT(build/unsigned)
+  const char* format() const { return m_is_capture ? "capture" : "trace"; }
+
+private:
+  const HSI_FRAME_STRUCT* capture_frame(std::size_t index) const;
+
+  std::string m_path;
+  const unsigned char* m_data = nullptr;
+  std::size_t m_file_size = 0;
+  bool m_is_capture = false;
+
+  std::size_t m_num_entries = 0;
+  std::size_t m_position = 0;
+  uint64_t m_clock_frequency_hz = 0; // NOLINT(build/unsigned)
+
+  // capture layout
+  std::size_t m_header_size = 0;
+  std::size_t m_block_size = 0;
+  std::size_t m_frames_per_block = 0;
+  uint64_t m_previous_timestamp = 0; // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITRACEREADER_HPP_
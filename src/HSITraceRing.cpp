@@ -0,0 +1,142 @@
+/**
+ * @file HSITraceRing.cpp Per-thread binary trace ring for the HSI hot paths
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#include "HSITraceRing.hpp"
+
+#include "logging/Logging.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+namespace {
+
+constexpr char s_dump_magic[8] = { 'H', 'S', 'I', 'R', 'N', 'G', '0', '1' };
+constexpr uint32_t s_dump_version = 1; // NOLINT(build/unsigned)
+constexpr std::size_t s_dump_text_size = 64;
+
+std::size_t
+round_up_to_power_of_two(std::size_t value)
+{
+  std::size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+void
+write_text(std::ofstream& out, const std::string& text)
+{
+  char buffer[s_dump_text_size] = {};
+  std::memcpy(buffer, text.data(), std::min(text.size(), s_dump_text_size - 1));
+  out.write(buffer, s_dump_text_size);
+}
+
+} // namespace
+
+HSITraceRing::HSITraceRing(std::string name, std::size_t capacity)
+  : m_name(std::move(name))
+  , m_records(round_up_to_power_of_two(std::max<std::size_t>(capacity, 2)))
+  , m_mask(m_records.size() - 1)
+{
+}
+
+std::vector<HSITraceRecord>
+HSITraceRing::snapshot() const
+{
+  auto head = m_head.load(std::memory_order_acquire);
+  auto count = std::min<uint64_t>(head, m_records.size()); // NOLINT(build/unsigned)
+  std::vector<HSITraceRecord> records;
+  records.reserve(count);
+  for (auto index = head - count; index < head; ++index) {
+    records.push_back(m_records[index & m_mask]);
+  }
+  return records;
+}
+
+bool
+HSITraceRing::dump(const std::string& path, const std::string& reason) const
+{
+  auto records = snapshot();
+  uint64_t written = m_head.load(std::memory_order_acquire); // NOLINT(build/unsigned)
+  uint64_t count = records.size();                           // NOLINT(build/unsigned)
+  uint64_t overwritten = written - count;                    // NOLINT(build/unsigned)
+  uint32_t record_size = sizeof(HSITraceRecord);             // NOLINT(build/unsigned)
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(s_dump_magic, sizeof(s_dump_magic));
+  out.write(reinterpret_cast<const char*>(&s_dump_version), sizeof(s_dump_version));
+  out.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(&overwritten), sizeof(overwritten));
+  write_text(out, m_name);
+  write_text(out, reason);
+  out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(HSITraceRecord));
+  return static_cast<bool>(out);
+}
+
+HSITraceRegistry&
+HSITraceRegistry::get()
+{
+  static HSITraceRegistry registry;
+  return registry;
+}
+
+void
+HSITraceRegistry::attach_current_thread(const std::string& name, std::size_t capacity)
+{
+  if (capacity == 0) {
+    t_hsi_trace_ring = nullptr;
+    return;
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& ring = m_rings[name];
+  if (!ring || ring->capacity() < capacity) {
+    ring = std::make_shared<HSITraceRing>(name, capacity);
+  }
+  t_hsi_trace_ring = ring.get();
+}
+
+std::vector<std::string>
+HSITraceRegistry::dump(const std::string& directory, const std::string& prefix, const std::string& reason)
+{
+  std::vector<std::shared_ptr<HSITraceRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [name, ring] : m_rings) {
+      if (name.compare(0, prefix.size(), prefix) == 0) {
+        rings.push_back(ring);
+      }
+    }
+  }
+
+  auto stamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                 .count();
+  std::vector<std::string> files;
+  for (auto& ring : rings) {
+    auto file_name = ring->name();
+    std::replace(file_name.begin(), file_name.end(), '/', '_');
+    auto path = directory + "/" + file_name + "_" + std::to_string(stamp) + ".hsiring";
+    if (ring->dump(path, reason)) {
+      files.push_back(path);
+    } else {
+      TLOG() << "Failed to write HSI trace ring dump " << path;
+    }
+  }
+  return files;
+}
+
+} // namespace hsilibs
+} // namespace dunedaq
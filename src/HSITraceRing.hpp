@@ -0,0 +1,151 @@
+/**
+ * @file HSITraceRing.hpp Per-thread binary trace ring for the HSI hot paths
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_HSITRACERING_HPP_
+#define HSILIBS_SRC_HSITRACERING_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dunedaq {
+namespace hsilibs {
+
+enum class HSITraceStage : uint16_t // NOLINT(build/unsigned)
+{
+  kPoll = 1,        // aux: words in the hardware buffer; status 1 in emulation mode
+  kDecode = 2,      // one event decoded from the buffer; header: buffer header, signal_map: trigger word, aux: data word
+  kSendEvent = 3,   // HSIEvent sent; status: timed out attempts, header: device id, aux: sequence counter
+  kSendRaw = 4,     // raw frame sent to the data handler; status 1 if it timed out, aux: sequence counter
+  kGenerate = 5,    // event produced by the fake generator; header: device id, aux: sequence counter
+  kError = 15       // status: an HSITraceError; header: buffer header of the event, if any
+};
+
+enum class HSITraceError : uint16_t // NOLINT(build/unsigned)
+{
+  kUdpTimeout = 1,
+  kInvalidHeader = 2,
+  kInvalidTimestamp = 3,
+  kInvalidWordCount = 4 // aux: number of words read
+};
+
+/**
+ * @brief One 32-byte trace record, written with a few plain stores.
+ *
+ * The layout is also read by scripts/hsi_trace_ring_decode.py.
+ */
+struct HSITraceRecord
+{
+  uint64_t time_ns;    // NOLINT(build/unsigned) steady clock
+  uint64_t timestamp;  // NOLINT(build/unsigned) DAQ timestamp of the event, if any
+  uint32_t header;     // NOLINT(build/unsigned) meaning depends on the stage, see HSITraceStage
+  uint32_t signal_map; // NOLINT(build/unsigned)
+  uint16_t stage;      // NOLINT(build/unsigned)
+  uint16_t status;     // NOLINT(build/unsigned)
+  uint32_t aux;        // NOLINT(build/unsigned)
+};
+static_assert(sizeof(HSITraceRecord) == 32, "trace record layout is part of the dump format");
+
+/**
+ * @brief Fixed-size ring of the most recent trace records of one thread.
+ *
+ * Single writer. A dump taken while the owner is writing may contain one
+ * torn record at the head; everything older is intact.
+ */
+class HSITraceRing
+{
+public:
+  HSITraceRing(std::string name, std::size_t capacity);
+
+  void record(HSITraceStage stage,
+              uint16_t status,     // NOLINT(build/unsigned)
+              uint64_t timestamp,  // NOLINT(build/unsigned)
+              uint32_t header,     // NOLINT(build/unsigned)
+              uint32_t signal_map, // NOLINT(build/unsigned)
+              uint32_t aux)        // NOLINT(build/unsigned)
+  {
+    auto head = m_head.load(std::memory_order_relaxed);
+    auto& record = m_records[head & m_mask];
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+    record.timestamp = timestamp;
+    record.header = header;
+    record.signal_map = signal_map;
+    record.stage = static_cast<uint16_t>(stage); // NOLINT(build/unsigned)
+    record.status = status;
+    record.aux = aux;
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  const std::string& name() const { return m_name; }
+  std::size_t capacity() const { return m_records.size(); }
+  uint64_t written() const { return m_head.load(std::memory_order_acquire); } // NOLINT(build/unsigned)
+
+  // oldest first
+  std::vector<HSITraceRecord> snapshot() const;
+
+  // binary dump: HSIRNG01 header followed by the records; returns false on I/O error
+  bool dump(const std::string& path, const std::string& reason) const;
+
+private:
+  std::string m_name;
+  std::vector<HSITraceRecord> m_records;
+  std::size_t m_mask;
+  std::atomic<uint64_t> m_head{ 0 }; // NOLINT(build/unsigned)
+};
+
+// ring of the calling thread, null while tracing is off for it
+inline thread_local HSITraceRing* t_hsi_trace_ring = nullptr;
+
+inline void
+hsi_trace(HSITraceStage stage,
+          uint16_t status,         // NOLINT(build/unsigned)
+          uint64_t timestamp = 0,  // NOLINT(build/unsigned)
+          uint32_t header = 0,     // NOLINT(build/unsigned)
+          uint32_t signal_map = 0, // NOLINT(build/unsigned)
+          uint32_t aux = 0)        // NOLINT(build/unsigned)
+{
+  if (t_hsi_trace_ring != nullptr) {
+    t_hsi_trace_ring->record(stage, status, timestamp, header, signal_map, aux);
+  }
+}
+
+/**
+ * @brief Owns every trace ring of the process so they outlive their threads.
+ *
+ * Rings are keyed by name: a thread that restarts every run gets its old
+ * ring back instead of a new one.
+ */
+class HSITraceRegistry
+{
+public:
+  static HSITraceRegistry& get();
+
+  // give the calling thread a ring; capacity 0 turns tracing off for it
+  void attach_current_thread(const std::string& name, std::size_t capacity);
+
+  // dump the rings whose name starts with prefix into directory; returns the files written
+  std::vector<std::string> dump(const std::string& directory, const std::string& prefix, const std::string& reason);
+
+private:
+  HSITraceRegistry() = default;
+
+  std::mutex m_mutex;
+  std::map<std::string, std::shared_ptr<HSITraceRing>> m_rings;
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_HSITRACERING_HPP_
@@ -0,0 +1,133 @@
+/**
+ * @file LogHistogram.hpp Lock-free histogram with power-of-two bins
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+#ifndef HSILIBS_SRC_LOGHISTOGRAM_HPP_
+#define HSILIBS_SRC_LOGHISTOGRAM_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace dunedaq {
+namespace hsilibs {
+
+/**
+ * @brief Histogram of unsigned values with bin i holding [2^(i-1), 2^i).
+ *
+ * Bin 0 holds the value 0, the last bin is an overflow bin. Filling is
+ * meant for a single writer thread: counters are updated with relaxed
+ * load/store pairs so that filling costs a handful of plain stores, while
+ * any other thread may read a (slightly stale) consistent-enough snapshot.
+ */
+template<std::size_t NBins = 48>
+class LogHistogram
+{
+public:
+  static constexpr std::size_t s_num_bins = NBins;
+
+  LogHistogram() { reset(); }
+
+  void reset()
+  {
+    for (auto& bin : m_bins) {
+      bin.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed); // NOLINT(build/unsigned)
+    m_max.store(0, std::memory_order_relaxed);
+  }
+
+  static std::size_t bin_index(uint64_t value) // NOLINT(build/unsigned)
+  {
+    if (value == 0) {
+      return 0;
+    }
+    std::size_t index = 64 - __builtin_clzll(value);
+    return index < NBins ? index : NBins - 1;
+  }
+
+  /**
+   * @brief Lower edge of bin i; the upper edge is bin_low_edge(i + 1)
+   */
+  static uint64_t bin_low_edge(std::size_t index) // NOLINT(build/unsigned)
+  {
+    return index == 0 ? 0 : (1ULL << (index - 1));
+  }
+
+  // Single writer only
+  void fill(uint64_t value) // NOLINT(build/unsigned)
+  {
+    auto& bin = m_bins[bin_index(value)];
+    bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    m_sum.store(m_sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value < m_min.load(std::memory_order_relaxed)) {
+      m_min.store(value, std::memory_order_relaxed);
+    }
+    if (value > m_max.load(std::memory_order_relaxed)) {
+      m_max.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); } // NOLINT(build/unsigned)
+  uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }     // NOLINT(build/unsigned)
+  uint64_t min() const { return count() ? m_min.load(std::memory_order_relaxed) : 0; } // NOLINT(build/unsigned)
+  uint64_t max() const { return m_max.load(std::memory_order_relaxed); }     // NOLINT(build/unsigned)
+  uint64_t bin(std::size_t index) const { return m_bins[index].load(std::memory_order_relaxed); } // NOLINT
+
+  double mean() const
+  {
+    auto n = count();
+    return n ? static_cast<double>(sum()) / n : 0.;
+  }
+
+  /**
+   * @brief Approximate quantile, interpolated linearly inside the bin
+   */
+  double quantile(double q) const
+  {
+    std::array<uint64_t, NBins> bins; // NOLINT(build/unsigned)
+    uint64_t total = 0;               // NOLINT(build/unsigned)
+    for (std::size_t i = 0; i < NBins; ++i) {
+      bins[i] = bin(i);
+      total += bins[i];
+    }
+    if (total == 0) {
+      return 0.;
+    }
+    double target = q * total;
+    double cumulative = 0.;
+    for (std::size_t i = 0; i < NBins; ++i) {
+      if (bins[i] == 0) {
+        continue;
+      }
+      if (cumulative + bins[i] >= target) {
+        double low = bin_low_edge(i);
+        double high = (i + 1 < NBins) ? bin_low_edge(i + 1) : static_cast<double>(max());
+        double fraction = (target - cumulative) / bins[i];
+        return low + fraction * (high - low);
+      }
+      cumulative += bins[i];
+    }
+    return static_cast<double>(max());
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, NBins> m_bins; // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_count;                   // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_sum;                     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_min;                     // NOLINT(build/unsigned)
+  std::atomic<uint64_t> m_max;                     // NOLINT(build/unsigned)
+};
+
+} // namespace hsilibs
+} // namespace dunedaq
+
+#endif // HSILIBS_SRC_LOGHISTOGRAM_HPP_
@@ -0,0 +1,98 @@
+/**
+ * @file HSIFrameProcessor_test.cxx HSIFrameProcessor frame error check Unit Tests
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "HSIFrameProcessor.hpp"
+#include "hsilibs/HSIEventSender.hpp"
+
+#define BOOST_TEST_MODULE HSIFrameProcessor_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+using namespace dunedaq;
+using namespace dunedaq::hsilibs;
+
+BOOST_AUTO_TEST_SUITE(HSIFrameProcessor_test)
+
+namespace {
+
+class TestFrameProcessor : public HSIFrameProcessor
+{
+public:
+  using HSIFrameProcessor::HSIFrameProcessor;
+
+  void check(const HSI_FRAME_STRUCT& frame) { frame_error_check(&frame); }
+  int timestamp_errors() const { return m_ts_error_ctr.load(); }
+  int sequence_gaps() const { return m_seq_gap_ctr.load(); }
+};
+
+HSI_FRAME_STRUCT
+make_frame(uint64_t timestamp, uint32_t sequence, uint32_t device_id) // NOLINT(build/unsigned)
+{
+  return HSIEventSender::pack_raw_hsi_data(HSIEventSender::make_raw_hsi_data(timestamp, 0x1, 0x1, sequence, device_id));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(SourceIdRoundTrip)
+{
+  for (uint32_t device_id : { 0x0U, 0x1U, 0x3ffU, 0x400U, 0xaa00U, 0xfffffU }) { // NOLINT(build/unsigned)
+    auto frame = make_frame(1000, 1, device_id);
+    BOOST_REQUIRE_EQUAL(frame.get_source_id(), device_id);
+    BOOST_REQUIRE_EQUAL(frame.get_timestamp(), 1000U);
+    BOOST_REQUIRE_EQUAL(frame.frame.sequence, 1U);
+    BOOST_REQUIRE_EQUAL(frame.frame.version, 1U);
+    BOOST_REQUIRE_EQUAL(frame.frame.detector_id, 1U);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TwoDevicesNoSequenceGaps)
+{
+  std::unique_ptr<datahandlinglibs::FrameErrorRegistry> error_registry =
+    std::make_unique<datahandlinglibs::FrameErrorRegistry>();
+  TestFrameProcessor processor(error_registry, false);
+
+  // two emulated devices with their own sequence counters in one frame stream;
+  // every third event of device 2 is due in the same tick as one of device 1
+  uint32_t sequence_1 = 0; // NOLINT(build/unsigned)
+  uint32_t sequence_2 = 0; // NOLINT(build/unsigned)
+  for (uint64_t tick = 1; tick <= 3000; ++tick) { // NOLINT(build/unsigned)
+    uint64_t ts = tick * 100;                     // NOLINT(build/unsigned)
+    processor.check(make_frame(ts, ++sequence_1, 1));
+    if (tick % 3 == 0) {
+      processor.check(make_frame(ts, ++sequence_2, 2));
+    } else if (tick % 3 == 1) {
+      processor.check(make_frame(ts + 50, ++sequence_2, 2));
+    }
+  }
+
+  BOOST_REQUIRE_EQUAL(processor.sequence_gaps(), 0);
+  BOOST_REQUIRE_EQUAL(processor.timestamp_errors(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GapsAreCountedPerSource)
+{
+  std::unique_ptr<datahandlinglibs::FrameErrorRegistry> error_registry =
+    std::make_unique<datahandlinglibs::FrameErrorRegistry>();
+  TestFrameProcessor processor(error_registry, false);
+
+  processor.check(make_frame(100, 1, 1));
+  processor.check(make_frame(100, 1, 2));
+  processor.check(make_frame(200, 2, 1));
+  processor.check(make_frame(300, 4, 2)); // device 2 skips sequence 2 and 3
+  processor.check(make_frame(150, 3, 1)); // device 1 goes back in time
+
+  BOOST_REQUIRE_EQUAL(processor.sequence_gaps(), 1);
+  BOOST_REQUIRE_EQUAL(processor.timestamp_errors(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+/**
+ * @file HSISignalMapSampler_test.cxx HSISignalMapSampler class Unit Tests
+ *
+ * This is part of the DUNE DAQ , copyright 2020.
+ * Licensing/copyright details are in the COPYING file that you should have
+ * received with this code.
+ */
+
+#include "HSISignalMapSampler.hpp"
+
+#define BOOST_TEST_MODULE HSISignalMapSampler_test // NOLINT
+
+#include "boost/test/unit_test.hpp"
+
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+using namespace dunedaq::hsilibs;
+
+BOOST_AUTO_TEST_SUITE(HSISignalMapSampler_test)
+
+namespace {
+
+constexpr unsigned s_num_signals = HSISignalMapSampler::s_num_signals;
+constexpr int s_num_maps = 200000;
+
+// what the fake generator did before the sampler: one Poisson draw per bit
+uint32_t // NOLINT(build/unsigned)
+reference_signal_map(std::poisson_distribution<uint64_t>& poisson, std::mt19937& generator) // NOLINT(build/unsigned)
+{
+  uint32_t signal_map = 0; // NOLINT(build/unsigned)
+  for (unsigned i = 0; i < s_num_signals; ++i) {
+    if (poisson(generator)) {
+      signal_map |= (1U << i);
+    }
+  }
+  return signal_map;
+}
+
+struct MapStatistics
+{
+  std::array<double, s_num_signals> bit_frequency{};
+  std::array<double, s_num_signals + 1> popcount_frequency{};
+
+  void add(uint32_t signal_map) // NOLINT(build/unsigned)
+  {
+    for (unsigned i = 0; i < s_num_signals; ++i) {
+      bit_frequency[i] += (signal_map >> i) & 0x1;
+    }
+    popcount_frequency[std::bitset<s_num_signals>(signal_map).count()] += 1;
+  }
+
+  void normalise(int n)
+  {
+    for (auto& f : bit_frequency) {
+      f /= n;
+    }
+    for (auto& f : popcount_frequency) {
+      f /= n;
+    }
+  }
+};
+
+void
+compare_with_reference(double mean, uint32_t enabled_signals) // NOLINT(build/unsigned)
+{
+  std::mt19937 sampler_generator(1234);
+  std::mt19937 reference_generator(5678);
+  HSISignalMapSampler sampler(HSISignalMapSampler::probability_from_poisson_mean(mean));
+  std::poisson_distribution<uint64_t> poisson(mean); // NOLINT(build/unsigned)
+
+  MapStatistics fast, reference;
+  for (int i = 0; i < s_num_maps; ++i) {
+    fast.add(sampler(sampler_generator) & enabled_signals);
+    reference.add(reference_signal_map(poisson, reference_generator) & enabled_signals);
+  }
+  fast.normalise(s_num_maps);
+  reference.normalise(s_num_maps);
+
+  // a few standard deviations of the difference of two frequencies estimated from 200k maps
+  const double tolerance = 0.006;
+  for (unsigned i = 0; i < s_num_signals; ++i) {
+    BOOST_TEST_INFO("mean " << mean << ", bit " << i);
+    BOOST_CHECK_SMALL(fast.bit_frequency[i] - reference.bit_frequency[i], tolerance);
+  }
+  for (unsigned k = 0; k <= s_num_signals; ++k) {
+    BOOST_TEST_INFO("mean " << mean << ", " << k << " bits set");
+    BOOST_CHECK_SMALL(fast.popcount_frequency[k] - reference.popcount_frequency[k], tolerance);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ProbabilityFromPoissonMean)
+{
+  BOOST_REQUIRE_EQUAL(HSISignalMapSampler::probability_from_poisson_mean(0.), 0.);
+  BOOST_REQUIRE_EQUAL(HSISignalMapSampler::probability_from_poisson_mean(-1.), 0.);
+  BOOST_REQUIRE_CLOSE(HSISignalMapSampler::probability_from_poisson_mean(1.), 1. - std::exp(-1.), 1.e-9);
+  BOOST_REQUIRE_LE(HSISignalMapSampler::probability_from_poisson_mean(1.e6), 1.);
+}
+
+BOOST_AUTO_TEST_CASE(MatchesPerBitPoissonLoop)
+{
+  // the low means mostly draw few bits, the high ones mostly go through the inverted (cleared bits) branch
+  for (double mean : { 0.01, 0.1, 0.5, 1., 3. }) {
+    compare_with_reference(mean, UINT32_MAX);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MatchesPerBitPoissonLoopWithEnabledSignals)
+{
+  compare_with_reference(0.5, 0x00ff00f0);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyMask)
+{
+  std::mt19937 generator(1);
+  HSISignalMapSampler sampler;
+  BOOST_REQUIRE_EQUAL(sampler.probability(), 0.);
+  for (int i = 0; i < 1000; ++i) {
+    BOOST_REQUIRE_EQUAL(sampler(generator), 0U);
+  }
+
+  // probabilities are clamped to [0, 1]
+  sampler.set_probability(-0.5);
+  BOOST_REQUIRE_EQUAL(sampler.probability(), 0.);
+  BOOST_REQUIRE_EQUAL(sampler(generator), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(FullMask)
+{
+  std::mt19937 generator(2);
+  HSISignalMapSampler sampler(1.);
+  for (int i = 0; i < 1000; ++i) {
+    BOOST_REQUIRE_EQUAL(sampler(generator), UINT32_MAX);
+  }
+
+  sampler.set_probability(1.5);
+  BOOST_REQUIRE_EQUAL(sampler.probability(), 1.);
+  BOOST_REQUIRE_EQUAL(sampler(generator), UINT32_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(HighMultiplicity)
+{
+  // at a mean multiplicity of 32 and above a cleared bit has probability exp(-32) per bit
+  std::mt19937 generator(3);
+  for (double mean : { 32., 100., 1.e6 }) {
+    HSISignalMapSampler sampler(HSISignalMapSampler::probability_from_poisson_mean(mean));
+    BOOST_REQUIRE(std::isfinite(sampler.probability()));
+    BOOST_REQUIRE_LE(sampler.probability(), 1.);
+    for (int i = 0; i < 10000; ++i) {
+      BOOST_TEST_INFO("mean " << mean);
+      BOOST_REQUIRE_EQUAL(sampler(generator), UINT32_MAX);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()